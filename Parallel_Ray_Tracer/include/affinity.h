@@ -0,0 +1,57 @@
+#ifndef __AFFINITY_H__
+#define __AFFINITY_H__
+
+#include <string>
+#include <cstddef>
+#include "options.h"
+
+//This file handles pinning processes to cores and placing memory on the
+//NUMA node of the core that uses it. The topology is read from sysfs, so
+//there are no MPI or hwloc dependencies here.
+
+//This function will pin the calling process to one core, chosen by its
+//index among the processes on the same node. Compact fills one socket
+//before moving on to the next; scatter deals the processes out over the
+//sockets in turn. Only the cores that the launcher allowed are used.
+//
+//Inputs:
+//    mode - how to spread the processes over the cores.
+//    localRank - the index of this process among those on the same node.
+//    report - filled with a description of the binding.
+//
+//Outputs:
+//    true if the process was pinned; otherwise, false
+bool bindProcess(BindMode mode, int localRank, std::string* report);
+
+//This function will widen the binding of the calling process to every
+//allowed core on its NUMA node. This is used before starting threads, so
+//that they are not all stuck on the one core of the process.
+//
+//Inputs: None
+//
+//Outputs: None
+void widenToNode();
+
+//This function will allocate memory that is placed on the NUMA node of
+//the calling process. The pages are bound with mbind() where the kernel
+//supports it and are always touched once here, so that first-touch places
+//them on this node otherwise. Memory that a pinned process allocates and
+//fills itself (like the buffers of the slaves) already lands on its node.
+//
+//Inputs:
+//    bytes - the size of the allocation.
+//
+//Outputs:
+//    The memory, or NULL if it could not be allocated.
+void* allocateLocal(size_t bytes);
+
+//This function will release memory from allocateLocal().
+//
+//Inputs:
+//    memory - the memory to release.
+//    bytes - the size that was passed to allocateLocal().
+//
+//Outputs: None
+void freeLocal(void* memory, size_t bytes);
+
+#endif
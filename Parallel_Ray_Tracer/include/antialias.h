@@ -0,0 +1,160 @@
+#ifndef __ANTIALIAS_H__
+#define __ANTIALIAS_H__
+
+#include <vector>
+#include "RayTrace.h"
+
+//This file holds the adaptive anti-aliasing used by -aa. Pixels whose
+//neighbours differ from them by more than the threshold are shaded again
+//as AA_FACTOR x AA_FACTOR sub-pixels, each traced with its own ray, and
+//replaced by their average; every other pixel keeps its one sample. It
+//works on one tile at a time, so every partitioning mode can call it on
+//whatever it has just rendered, and the result does not depend on how the
+//image was cut up.
+//
+//The camera of a scene is built for the -w and -h it was loaded with, so
+//the sub-pixel rays are traced in a second copy of the scene, loaded by
+//antialiasLoad() at AA_FACTOR times the size of the frame. Sub-pixel
+//(a, b) of pixel (row, column) is pixel (AA_FACTOR * row + a,
+//AA_FACTOR * column + b) of that copy. Loading the scene twice costs the
+//time and memory of a second initialize().
+
+//The number of sub-pixels across and down a refined pixel.
+#define AA_FACTOR 2
+
+//Define a structure that will be used to count the work done by -aa. The
+//extra samples are the sub-pixel rays and the pixels next to a tile that
+//had to be shaded again to find its edges.
+typedef struct
+{
+    long long pixels;
+    long long refined;
+    long long extraSamples;
+} AntialiasStats;
+
+//The counts for this process, kept per thread like the cost grid.
+extern thread_local AntialiasStats antialiasStats;
+
+//Define a structure that will be used to pass the last row of a band, as
+//it was before anti-aliasing, on to the next band of the same region, so
+//that it is not shaded again. colors is empty until the first band.
+typedef struct
+{
+    int row;
+    std::vector<float> colors;
+} AntialiasCarry;
+
+//The scene loaded at AA_FACTOR times the size of the frame, that the
+//sub-pixel rays are traced in. It is only loaded when -aa is given.
+extern ConfigData antialiasFrame;
+
+//This function will load the scene a second time, at AA_FACTOR times the
+//width and height of the frame, for the sub-pixel rays. It should be
+//called with the same arguments as initialize(), before regionInit().
+//
+//Inputs:
+//    argc - the number of arguments that were given to initialize().
+//    argv - the arguments that were given to initialize().
+//    data - the ConfigData that initialize() filled in, for the size.
+//    frame - filled in with the larger scene.
+//
+//Outputs:
+//    true if the scene could not be loaded; otherwise, false
+bool antialiasLoad(int argc, char** argv, const ConfigData* data, ConfigData* frame);
+
+//This function will shade one sub-pixel of a pixel with its own ray, from
+//antialiasFrame.
+//
+//Inputs:
+//    color - a float array of 3 elements to write the color to.
+//    row - the row of the pixel, between 0 and height - 1.
+//    column - the column of the pixel, between 0 and width - 1.
+//    subRow, subColumn - the sub-pixel, from 0 to AA_FACTOR - 1.
+//
+//Outputs: None
+void shadeSubPixel(float* color, int row, int column, int subRow, int subColumn);
+
+//This function will anti-alias a tile that has just been rendered, if -aa
+//was given. The pixels just outside of the tile are shaded again so that
+//the edges of the tile are handled the same as its middle.
+//
+//Inputs:
+//    tile - the rendered pixels of the tile; refined pixels are replaced.
+//    stride - the number of floats between the starts of two rows in tile.
+//    firstRow, firstCol - the image position of the top left pixel.
+//    numRows, numCols - the size of the tile.
+//    data - the ConfigData that holds the scene information.
+//
+//Outputs: None
+void antialiasTile(float* tile, int stride, int firstRow, int firstCol, int numRows, int numCols, ConfigData* data);
+
+//This function will move the rows of a band that is about to be shaded,
+//if -aa was given, so that the first row of the next band is shaded with
+//this one and left out of the next. antialiasBand() then finds it below
+//the band instead of shading it again.
+//
+//Inputs:
+//    numRows - the number of rows in the region.
+//    first, count - the rows of the band, from bandRows(); changed to the
+//        rows to shade.
+//
+//Outputs: None
+void antialiasBandRows(int numRows, int* first, int* count);
+
+//This function will anti-alias one band of a region that is rendered band
+//by band. The row above the band comes from carry and, if belowShaded, the
+//row below is the one after the band in the buffer, shaded by
+//antialiasBandRows(); only the pixels beside the band are shaded again.
+//
+//Inputs:
+//    tile - the rendered pixels of the band; refined pixels are replaced.
+//    stride - the number of floats between the starts of two rows in tile.
+//    firstRow, firstCol - the image position of the top left pixel.
+//    numRows, numCols - the size of the band.
+//    belowShaded - true if the row after the band is in tile and shaded.
+//    carry - the last row of the previous band; this band's is left in it.
+//    data - the ConfigData that holds the scene information.
+//
+//Outputs: None
+void antialiasBand(float* tile, int stride, int firstRow, int firstCol, int numRows, int numCols,
+                   bool belowShaded, AntialiasCarry* carry, ConfigData* data);
+
+//This function will anti-alias a set of full width image rows, such as the
+//cycles of the cycles mode, treating each run of adjacent rows as a band.
+//
+//Inputs:
+//    pixels - the rendered rows, one after another.
+//    rows - the image row of each row in pixels, in increasing order.
+//    nextRow - the image row after the last one in pixels, if it is
+//        already shaded; otherwise, -1.
+//    carry - the last row of the previous band, or NULL.
+//    data - the ConfigData that holds the scene information.
+//
+//Outputs: None
+void antialiasRows(float* pixels, const std::vector<int>& rows, int nextRow, AntialiasCarry* carry, ConfigData* data);
+
+//This function will anti-alias a tile of an image that has been shaded in
+//full, as raytrace_seq -t does once all of its tiles are done. The pixels
+//around the tile are read from a copy of the image taken before anything
+//was refined, so none of them are shaded again.
+//
+//Inputs:
+//    pixels - the image; refined pixels of the tile are replaced.
+//    unrefined - the copy of the image.
+//    firstRow, firstCol - the image position of the top left pixel.
+//    numRows, numCols - the size of the tile.
+//    data - the ConfigData that holds the scene information.
+//
+//Outputs: None
+void antialiasImageTile(float* pixels, const float* unrefined, int firstRow, int firstCol, int numRows, int numCols, ConfigData* data);
+
+//This function will print how many pixels were anti-aliased and how many
+//extra samples it took.
+//
+//Inputs:
+//    stats - the counts, summed over every process.
+//
+//Outputs: None
+void printAntialiasStats(const AntialiasStats* stats);
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef __BANDS_H__
+#define __BANDS_H__
+
+#include <vector>
+#include <mpi.h>
+#include "RayTrace.h"
+
+//This file holds the messages that the static modes use to send a region
+//to the master a band of rows at a time. A slave sends each band with
+//MPI_Isend as soon as it is rendered and goes on with the next one, and the
+//master has the receives for every band posted before it starts its own
+//share, so most of the transfer happens while shading. The region is laid
+//out row by row with the computation time after the last row, as before;
+//the last band carries that time. With -compress, every band is sent as
+//one message of the tile codec instead.
+
+//Define a structure that will be used to describe the region of a slave:
+//the image rows it rendered, in order, and the columns of each row.
+typedef struct
+{
+    std::vector<int> rows;
+    int firstCol;
+    int numCols;
+} StaticRegion;
+
+//Define a structure that will be used to hold the receives of the master.
+typedef struct
+{
+    std::vector<StaticRegion> regions;
+    std::vector<float*> buffers;
+    std::vector<MPI_Request> requests;
+    std::vector<int> sources;
+    std::vector<int> bands;
+
+    //With -compress, the encoded message of each receive.
+    std::vector<float*> messages;
+} BandReceiver;
+
+//Define a structure that will be used to hold the sends of a slave.
+typedef struct
+{
+    std::vector<MPI_Request> requests;
+
+    //With -compress, the encoded bands that are being sent.
+    std::vector<float*> messages;
+} BandSender;
+
+//This function will post a receive for every band of every slave. The
+//caller fills in receiver->regions, indexed by rank, first; the entry for
+//the master is not used.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    receiver - the regions to receive.
+//
+//Outputs: None
+void postBandReceives(ConfigData* data, BandReceiver* receiver);
+
+//This function will wait for the bands posted by postBandReceives() and
+//copy each one into the image as it arrives.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    receiver - the receives that were posted.
+//    pixels - the image.
+//    communicationTime - the time spent waiting is added to this.
+//
+//Outputs:
+//    The total computation time of the slaves.
+double finishBandReceives(ConfigData* data, BandReceiver* receiver, float* pixels, double* communicationTime);
+
+//This function will start sending one band of a region to the master.
+//
+//Inputs:
+//    region - the rendered rows of the region, with one float for the
+//        computation time after them. The time must be filled in before
+//        the last band is sent.
+//    rowFloats - the number of floats in each row.
+//    numRows - the number of rows in the region.
+//    band - the band to send.
+//    sender - the send is added to this.
+//
+//Outputs: None
+void sendBand(float* region, int rowFloats, int numRows, int band, BandSender* sender);
+
+//This function will wait for every band sent with sendBand().
+//
+//Inputs:
+//    sender - the sends.
+//
+//Outputs: None
+void finishBandSends(BandSender* sender);
+
+#endif
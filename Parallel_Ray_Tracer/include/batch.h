@@ -0,0 +1,60 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include "RayTrace.h"
+
+//This file holds the batch mode used by -batch. A job file lists one
+//render per line, written as the options of a normal run:
+//
+//    # scene, size and mode; anything after '#' is ignored
+//    -c configs/twhitted.xml -w 1000 -h 1000 -p dynamic -bw 16 -bh 16
+//    -c configs/box.xml -w 500 -h 500 -p static_blocks -aa 0.05
+//
+//The options on the mpirun command line apply to every job, and a job can
+//override them. Each scene is loaded once per size: the engine is only
+//called for a job whose options (apart from -p, -bw, -bh and -cs) have not
+//been seen before, and the other jobs get a copy of its ConfigData with
+//their partitioning options set. With -pack <ranks>, the processes are
+//split into groups of that many ranks and the groups take the jobs in
+//turn, so small jobs run side by side.
+
+//The communicator that renders run on. It is MPI_COMM_WORLD, or the
+//group of a packed batch. mpi_rank and mpi_procs in ConfigData are the
+//rank and size within it.
+extern MPI_Comm renderComm;
+
+//This function will read the job file on rank 0 and share it with every
+//process.
+//
+//Inputs:
+//    filename - the job file.
+//    jobs - filled with the options of each job.
+//
+//Outputs:
+//    true if there was an error in the processing; otherwise, false
+bool readBatchJobs(std::string filename, std::vector< std::vector<std::string> >* jobs);
+
+//This function will parse the options of a job and fill in its ConfigData,
+//loading the scene only if it is not cached. Every process of renderComm
+//must call this for the same job.
+//
+//Inputs:
+//    launchArgs - the command line of the launch.
+//    job - the options of the job.
+//    data - filled in with the scene information of the job.
+//
+//Outputs:
+//    true if there was an error in the processing; otherwise, false
+bool loadBatchJob(const std::vector<std::string>& launchArgs, const std::vector<std::string>& job, ConfigData* data);
+
+//This function will clean up every cached scene.
+//
+//Inputs: None
+//
+//Outputs: None
+void releaseBatchScenes();
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef __BUFFER_POOL_H__
+#define __BUFFER_POOL_H__
+
+#include <cstddef>
+
+//This file holds a pool of the buffers that pixels are sent and received
+//in. The memory comes from MPI_Alloc_mem, so the MPI library can register
+//it for RDMA once, and released buffers are kept on a free list for their
+//size class (powers of two) instead of being returned. After the first few
+//units of a render, acquiring a buffer does not allocate.
+
+//This function will return a buffer of at least count floats.
+//
+//Inputs:
+//    count - the number of floats needed.
+//
+//Outputs:
+//    The buffer. Its contents are not cleared.
+float* poolAcquire(size_t count);
+
+//This function will put a buffer from poolAcquire() back into the pool.
+//
+//Inputs:
+//    buffer - the buffer to release. NULL is ignored.
+//
+//Outputs: None
+void poolRelease(float* buffer);
+
+//This function will return every pooled buffer to MPI. It must be called
+//before MPI_Finalize, and no buffer may be in use.
+//
+//Inputs: None
+//
+//Outputs: None
+void poolDrain();
+
+#endif
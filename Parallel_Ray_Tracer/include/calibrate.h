@@ -0,0 +1,33 @@
+#ifndef __CALIBRATE_H__
+#define __CALIBRATE_H__
+
+#include <string>
+#include "RayTrace.h"
+
+//This file holds the calibration used by -weighted. Before a static strips
+//or blocks render, every process shades the same sample of the image at
+//the same time and the number of pixels per second it managed becomes its
+//weight in rankWeights (see partition.h), so a process on a slower or
+//busier core gets a smaller part of the image.
+//
+//With -weights <file>, the weights are kept in a text file with one line
+//per rank:
+//
+//    <rank> <host> <weight> <pixels per second>
+//
+//and a later run with the same number of ranks on the same hosts reads
+//them instead of calibrating again.
+
+//The sample is a grid of this many pixels each way, spread over the image.
+#define CALIBRATE_GRID 24
+
+//This function will set rankWeights from the cache or by calibrating, and
+//print them. Every process of renderComm must call this.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//
+//Outputs: None
+void calibrateRanks(ConfigData* data);
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include <queue>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "RayTrace.h"
+#include "partition.h"
+
+//This file holds the checkpoints used by -checkpoint and -resume. The
+//image is only complete on the master when it is saved, so a render that
+//is stopped by a time limit loses everything. With -checkpoint, the master
+//counts the pixels that arrive in every CHECKPOINT_TILE x CHECKPOINT_TILE
+//tile of the image, and writes the finished tiles to a file every few
+//seconds and when the process gets SIGTERM (which SLURM sends before the
+//time limit kills the job).
+//
+//With -resume, every process reads the file (it must be on a file system
+//that they all see). The dynamic and hybrid modes drop the units whose
+//tiles are all finished; in every mode, shadePixelCosted() gives the saved
+//color for a pixel of a finished tile instead of shading it.
+//
+//The file has this layout (little endian):
+//    char[4]  "RTCK"
+//    int32    width, height - the size of the image
+//    int32    x, y - where the image is in the frame (with -roi)
+//    int32    tile - CHECKPOINT_TILE
+//    int32    done - the number of finished tiles
+//    uint8    bitmap[(tiles + 7) / 8] - bit t % 8 of byte t / 8 is set
+//             when tile t (row-major) is finished
+//    float    the RGB pixels of every finished tile in order, row by row,
+//             cut off at the edges of the image
+
+//The width and height of a tile, in pixels.
+#define CHECKPOINT_TILE 32
+
+//Define a structure that will be used to start the file.
+typedef struct
+{
+    char magic[4];
+    int width;
+    int height;
+    int x;
+    int y;
+    int tile;
+    int done;
+} CheckpointHeader;
+
+//Define a structure that will be used to hold the state of the checkpoints.
+typedef struct
+{
+    //The size of the image and the tiles it is cut into.
+    int width;
+    int height;
+    int tileCols;
+    int tileRows;
+
+    //The finished tiles, as in the file, and how many of them there are.
+    std::vector<unsigned char> bitmap;
+    int doneTiles;
+
+    //The tiles read with -resume: the index of each one in saved, or -1,
+    //and their pixels, CHECKPOINT_TILE x CHECKPOINT_TILE each.
+    bool resumed;
+    int resumedTiles;
+    std::vector<int> savedIndex;
+    std::vector<float> saved;
+
+    //The master's image, and with -checkpoint its record of the pixels
+    //that have arrived in each tile.
+    float* pixels;
+    bool tracking;
+    std::vector<int> filled;
+    double interval;
+    double lastWrite;
+    int writes;
+} Checkpoint;
+
+//The checkpoint of this process.
+extern Checkpoint checkpoint;
+
+//This function will read the -resume file and set up the tile counts for
+//-checkpoint. Every process should call this after regionInit(). Only the
+//master handles SIGTERM; the other processes ignore it while rendering,
+//so that the master has time to write the file.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//
+//Outputs:
+//    true if the -resume file could not be read or does not fit the
+//    image; otherwise, false
+bool checkpointInit(ConfigData* data);
+
+//This function will start counting the pixels that arrive in the image on
+//the master, with -checkpoint.
+//
+//Inputs:
+//    pixels - the image.
+//    track - false if the master does not get the image, in which case
+//        nothing is written.
+//
+//Outputs: None
+void checkpointStart(float* pixels, bool track);
+
+//This function will fill the image with the resumed tiles and drop the
+//units of the queue that only cover them, on the master. The units keep
+//their ids.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    queue - the dynamic units.
+//
+//Outputs: None
+void checkpointFilter(ConfigData* data, std::queue<WorkUnit>* queue);
+
+//This function will count a rectangle of the image that the master has
+//finished, and write the file when it is time to.
+//
+//Inputs:
+//    row - the first row of the rectangle.
+//    col - the first column of the rectangle.
+//    height - the rows in the rectangle.
+//    width - the columns in the rectangle.
+//
+//Outputs: None
+void checkpointTile(int row, int col, int height, int width);
+
+//This function will stop the checkpoints after the render and print how
+//many were written. Every process should call this.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//
+//Outputs: None
+void checkpointEnd(ConfigData* data);
+
+//This function will tell whether a pixel is of a resumed tile.
+//
+//Inputs:
+//    row - the row of the pixel within data.
+//    column - the column of the pixel within data.
+//
+//Outputs:
+//    true if the pixel was resumed; otherwise, false
+inline bool checkpointResumed(int row, int column)
+{
+    return checkpoint.savedIndex[(row / CHECKPOINT_TILE) * checkpoint.tileCols + column / CHECKPOINT_TILE] >= 0;
+}
+
+//This function will give the saved color of a pixel of a resumed tile.
+//
+//Inputs:
+//    color - the 3 floats to fill.
+//    row - the row of the pixel within data.
+//    column - the column of the pixel within data.
+//
+//Outputs:
+//    true if the pixel was resumed; otherwise, false
+inline bool checkpointColor(float* color, int row, int column)
+{
+    int tile = (row / CHECKPOINT_TILE) * checkpoint.tileCols + column / CHECKPOINT_TILE;
+    int index = checkpoint.savedIndex[tile];
+    if (index < 0) {
+        return false;
+    }
+    const float* saved = &checkpoint.saved[(size_t)index * 3 * CHECKPOINT_TILE * CHECKPOINT_TILE
+                                           + 3 * ((row % CHECKPOINT_TILE) * CHECKPOINT_TILE + column % CHECKPOINT_TILE)];
+    memcpy(color, saved, 3 * sizeof(float));
+    return true;
+}
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef __COST_MAP_H__
+#define __COST_MAP_H__
+
+#include <string>
+#include <vector>
+#include <x86intrin.h>
+#include "RayTrace.h"
+#include "region.h"
+#include "ray_stats.h"
+#include "checkpoint.h"
+
+//This file holds the per-region shading cost grid used by -costmap. The
+//image is divided into cols x rows cells and the time stamp counter
+//cycles spent in shadePixel() are added to the cell of each pixel.
+//
+//The grid is saved as a binary file with this layout (little endian):
+//    char[4]  "COST"
+//    int32    cols, rows - the size of the grid
+//    int32    width, height - the size of the image that was measured
+//    double   cost[rows * cols] - cycles per cell, row-major
+//
+//A file is rejected if its grid has more cells than COST_MAP_MAX_CELLS or
+//cells smaller than a pixel, so that a damaged header cannot make the
+//reader allocate an absurd amount of memory.
+#define COST_MAP_MAX_CELLS (1 << 24)
+
+typedef struct
+{
+    int cols;
+    int rows;
+    int width;
+    int height;
+    std::vector<double> cost;
+} CostMap;
+
+//The grid of this process. It is empty unless -costmap was given. Every
+//thread has its own, so that raytrace_seq -t can shade without locking;
+//the threads add theirs into the main thread's when they finish.
+extern thread_local CostMap costMap;
+
+//This function will set up the grid for the image, if -costmap was given.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    cols - the number of cells across; 0 disables the grid.
+//    rows - the number of cells down.
+//
+//Outputs: None
+void costMapInit(ConfigData* data, int cols, int rows);
+
+//This function finds the cell of the grid that a pixel falls into.
+inline int costMapCell(const CostMap* map, int row, int column)
+{
+    return (int)((long)row * map->rows / map->height) * map->cols
+         + (int)((long)column * map->cols / map->width);
+}
+
+//This function will shade a pixel of the engine's frame, adding the time
+//taken to the cell of (row, column) when the grid is enabled and counting
+//the ray with -raystats. shadePixelCosted() and the sub-pixel rays of -aa
+//both go through it.
+inline void shadeFrameCosted(float* color, int frameRow, int frameColumn, ConfigData* engine, int row, int column)
+{
+    if (costMap.cost.empty() && !rayStatsEnabled) {
+        shadePixel(color, frameRow, frameColumn, engine);
+        return;
+    }
+    unsigned long long start = __rdtsc();
+    shadePixel(color, frameRow, frameColumn, engine);
+    unsigned long long cycles = __rdtsc() - start;
+    if (!costMap.cost.empty()) {
+        costMap.cost[costMapCell(&costMap, row, column)] += (double)cycles;
+    }
+    if (rayStatsEnabled) {
+        rayStats.primaryRays++;
+        rayStats.shadeCycles += cycles;
+    }
+}
+
+//This function is shadePixelCosted() without -resume: the pixel is shaded
+//even if it was in the checkpoint. -aa uses it for the color that a
+//resumed pixel had before it was anti-aliased.
+inline void shadePixelAgain(float* color, int row, int column, ConfigData* data)
+{
+    if (renderRegion.active) {
+        shadeFrameCosted(color, row + renderRegion.y, column + renderRegion.x, &renderRegion.frame, row, column);
+        return;
+    }
+    shadeFrameCosted(color, row, column, data, row, column);
+}
+
+//This function is used in place of shadePixel() by the partitioning
+//functions. When the grid is enabled the time taken is added to the cell
+//of the pixel, and with -raystats the call is counted; otherwise it only
+//calls shadePixel(). With -resume, a pixel that was in the checkpoint gets
+//its saved color. With -roi, row and
+//column are within the region and are moved into the full frame here.
+inline void shadePixelCosted(float* color, int row, int column, ConfigData* data)
+{
+    //A pixel of a finished tile from -resume is not shaded again.
+    if (checkpoint.resumed && checkpointColor(color, row, column)) {
+        return;
+    }
+    shadePixelAgain(color, row, column, data);
+}
+
+//This function will write a grid in the binary format above.
+//
+//Outputs:
+//    true if the file was written; otherwise, false
+bool costMapWrite(std::string filename, const CostMap* map);
+
+//This function will read a grid in the binary format above.
+//
+//Outputs:
+//    true if the file was read and its header is sane; otherwise, false
+bool costMapRead(std::string filename, CostMap* map);
+
+//This function will write the grid as a false-color PNG, from blue for
+//the cheapest cells through green to red for the most expensive ones.
+//
+//Outputs:
+//    true if the file was written; otherwise, false
+bool costMapWriteHeatmap(std::string filename, const CostMap* map);
+
+#endif
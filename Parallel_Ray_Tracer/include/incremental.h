@@ -0,0 +1,77 @@
+#ifndef __INCREMENTAL_H__
+#define __INCREMENTAL_H__
+
+#include <queue>
+#include <string>
+#include <vector>
+#include "RayTrace.h"
+#include "partition.h"
+
+//This file holds the incremental re-render used by -incremental. After a
+//small edit to a scene, only the dynamic units whose pixels can have
+//changed are rendered again, and they are pasted over the render of the
+//scene before the edit.
+//
+//The engine does not show the objects of a scene to the program, so both
+//scene files are read here the way the engine reads them: the XML for the
+//camera, lights and models, and the OBJ and MTL files of each model, with
+//the model's matrices applied. Every sphere that was added, removed or
+//changed is projected into the image where it was and where it is now,
+//through the engine's camera, together with its shadow from every light
+//down to the floor (the plane that the triangle meshes lie in), and the
+//units that those bounds touch are dirty. A reflection or refraction of
+//the sphere can only show up on a mirror or glass object, so when the
+//scene has any, their bounds are dirty too.
+//
+//When the change cannot be bounded this way - the camera, background, a
+//light, a color or an illumination model changed, a triangle mesh changed
+//or is a mirror, a file cannot be read, or a bound passes behind the
+//camera or never meets the floor - every unit is dirty.
+
+//The pixels around the bounds that are marked as well, for the
+//anti-aliasing and rounding at their edges.
+#define INCREMENTAL_MARGIN 2
+
+//Define a structure that will be used to hold the dirty units.
+typedef struct
+{
+    bool active;
+
+    //One flag per dynamic unit, by the id createDynamicUnits() gives it.
+    std::vector<char> dirty;
+
+    //The number of objects that differ between the scenes, and why every
+    //unit is dirty if that had to be done (empty otherwise).
+    int changed;
+    std::string fallback;
+} IncrementalRender;
+
+//The dirty units of this run. It is not active unless -incremental was
+//given.
+extern IncrementalRender incrementalRender;
+
+//This function will compare the scene before the edit with the one being
+//rendered and find the dirty units. Every process of renderComm must call
+//this after regionInit(); the files are only read on the master.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//
+//Outputs:
+//    true if the scene before the edit could not be read or the mode
+//    cannot be used; otherwise, false
+bool incrementalInit(ConfigData* data);
+
+//This function will fill the image with the render before the edit and
+//drop the clean units from the queue, on the master. If the render cannot
+//be read, every unit is kept. The units keep their ids.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    pixels - the image, filled with the render before the edit.
+//    queue - the dynamic units, left with only the dirty ones.
+//
+//Outputs: None
+void incrementalFilter(ConfigData* data, float* pixels, std::queue<WorkUnit>* queue);
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef __LIVE_STREAM_H__
+#define __LIVE_STREAM_H__
+
+#include <string>
+#include "RayTrace.h"
+
+//This file holds the live stream used by -live <socket>. While the image
+//is rendered, the master sends every finished tile as 8 bit RGB to a UNIX
+//datagram socket, where the live_view tool puts the picture together. The
+//sends never wait: when nothing is listening, or the viewer has fallen
+//behind and the socket is full, the tile is dropped and only counted, so
+//the render runs just as fast as without a viewer.
+//
+//Every datagram is a LiveHeader followed by width * height RGB triples.
+//A frame starts with LIVE_BEGIN and ends with LIVE_END, which carry no
+//pixels; a tile that is too big for one datagram is cut into several.
+//The positions are in the full frame, also with -roi.
+
+#define LIVE_MAGIC 0x4556494c
+#define LIVE_BEGIN 0
+#define LIVE_TILE 1
+#define LIVE_END 2
+
+//The biggest datagram sent, well under the default socket buffer.
+#define LIVE_MAX_DATAGRAM 60000
+
+//Define a structure that will be used to start every datagram.
+typedef struct
+{
+    int magic;
+    int kind;
+    int frameWidth;
+    int frameHeight;
+    int x;
+    int y;
+    int width;
+    int height;
+} LiveHeader;
+
+//Define a structure that will be used to count what the stream did.
+typedef struct
+{
+    long long datagrams;
+    long long dropped;
+} LiveStats;
+
+extern LiveStats liveStats;
+
+//This function will open the socket and start a frame. Only the master
+//calls this, and nothing is sent unless it has been called.
+//
+//Inputs:
+//    path - the socket that the viewer listens on.
+//    data - the ConfigData that holds the scene information.
+//
+//Outputs:
+//    true if the socket could be created; otherwise, false
+bool liveOpen(std::string path, ConfigData* data);
+
+//This function will send a finished tile of the image.
+//
+//Inputs:
+//    pixels - the first pixel of the tile.
+//    stride - the number of floats from one row of the tile to the next.
+//    row - the row of the tile within data.
+//    col - the column of the tile within data.
+//    height - the rows in the tile.
+//    width - the columns in the tile.
+//
+//Outputs: None
+void liveTile(const float* pixels, int stride, int row, int col, int height, int width);
+
+//This function will end the frame and close the socket.
+//
+//Inputs: None
+//
+//Outputs: None
+void liveClose();
+
+//This function will print how many datagrams were sent and dropped.
+//
+//Inputs:
+//    stats - what the stream did.
+//
+//Outputs: None
+void printLiveStats(const LiveStats* stats);
+
+#endif
@@ -24,6 +24,11 @@ void masterSequential(ConfigData *data, float* pixels);
 // void staticStripsHorizontalMaster(ConfigData *data, float* pixels);
 void staticStripsVerticalMaster(ConfigData *data, float* pixels);
 void staticSquareBlocksMaster(ConfigData *data, float* pixels);
+void masterStaticCyclesHorizontal(ConfigData* data, float* pixels);
 void dynamicMaster(ConfigData* data, float* pixels);
 
+//This function will render a static share of the image in vertical strips
+//and then hand out the rest as dynamic units, for -p hybrid.
+void hybridMaster(ConfigData* data, float* pixels);
+
 #endif
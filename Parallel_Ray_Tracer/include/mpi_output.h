@@ -0,0 +1,82 @@
+#ifndef __MPI_OUTPUT_H__
+#define __MPI_OUTPUT_H__
+
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include "RayTrace.h"
+#include "options.h"
+
+//This function returns the name that the engine picks for the image, in
+//the renders directory. In a batch, the tag of the job is added before the
+//extension, as jobs can finish within the same second.
+//
+//Inputs: None
+//
+//Outputs:
+//    The name of the file.
+std::string renderFileName();
+
+//This function will pick the name of the output file on rank 0 and share
+//it with every other process. The extension matches the output format.
+//Every process must call this.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    format - the format that the image will be written in.
+//
+//Outputs:
+//    The name of the file, the same on every process.
+std::string shareOutputFileName(ConfigData* data, OutputFormat format);
+
+//This function will write a set of image rows into the output file using
+//one collective MPI-IO write. Each process passes only the part of the
+//image that it rendered; nothing is sent to the master. Every process in
+//the communicator must call this, even if it has no rows.
+//
+//Inputs:
+//    comm - the communicator that is writing the file.
+//    filename - the file to write into.
+//    data - the ConfigData that holds the scene information.
+//    format - raw, pfm or ppm.
+//    rows - the image rows that this process rendered, in the order that
+//        they appear in pixels.
+//    firstCol - the first column of each row that was rendered.
+//    numCols - the number of columns of each row that were rendered.
+//    pixels - the rendered pixels.
+//    stride - the number of floats between the starts of two rows in pixels.
+//
+//Outputs:
+//    true if the write succeeded; otherwise, false
+bool writeRowsCollective(MPI_Comm comm, std::string filename, ConfigData* data, OutputFormat format,
+                         const std::vector<int>& rows, int firstCol, int numCols,
+                         const float* pixels, int stride);
+
+//This function returns true when the output format and partitioning
+//mode mean that every process writes its own part of the image. Only the
+//static modes do this; otherwise the master writes the whole image.
+bool writesOwnRegion(ConfigData* data);
+
+//This function is called by the static partitioning functions, on every
+//process, in place of sending the pixels to the master. It writes the
+//rows into runOptions.outputFile and adds up the computation times of
+//every process on the master.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    rows, firstCol, numCols, pixels, stride - as in writeRowsCollective().
+//    computationTime - the computation time of this process.
+//
+//Outputs:
+//    The total computation time of every process on the master.
+double writeOwnRegion(ConfigData* data, const std::vector<int>& rows, int firstCol, int numCols,
+                      const float* pixels, int stride, double computationTime);
+
+//This function returns the rows firstRow to lastRow, inclusive.
+std::vector<int> rowRange(int firstRow, int lastRow);
+
+//This function returns the header that is written at the start of the
+//file for the given format. Raw files have no header.
+std::string outputHeader(OutputFormat format, int width, int height);
+
+#endif
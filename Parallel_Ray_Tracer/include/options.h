@@ -0,0 +1,135 @@
+#ifndef __RUN_OPTIONS_H__
+#define __RUN_OPTIONS_H__
+
+//This file holds the options that are not understood by the ray tracing
+//engine. RayTrace.h may not be modified, so these options are parsed
+//separately and removed from the argument list before initialize() sees it.
+
+#include <string>
+
+//Specify the formats that the image can be written in. Everything but
+//PNG is written by every process directly with MPI-IO.
+typedef enum{
+    OUTPUT_PNG = 0,
+    OUTPUT_RAW = 1,
+    OUTPUT_PFM = 2,
+    OUTPUT_PPM = 3
+} OutputFormat;
+
+//Specify how processes are pinned to cores.
+typedef enum{
+    BIND_NONE = 0,
+    BIND_COMPACT = 1,
+    BIND_SCATTER = 2
+} BindMode;
+
+//Define a structure that will be used to hold all of the extra options.
+typedef struct
+{
+    //PNG output: the engine's savePixels() unless -zl or -zt asks for the
+    //threaded writer
+    bool pngParallel;
+    int pngLevel;
+    int pngThreads;
+
+    //Output format and the file that every process writes into
+    OutputFormat outputFormat;
+    std::string outputFile;
+
+    //Dynamic partitioning
+    bool speculate;
+
+    //Static partitioning: the number of bands each region is sent in
+    int bands;
+
+    //Hybrid partitioning: -p hybrid and the share of the image done statically
+    bool hybrid;
+    double staticFraction;
+
+    //Process pinning
+    BindMode bindMode;
+
+    //Shading cost grid: -costmap <cols>x<rows>, 0 when not wanted
+    int costCols;
+    int costRows;
+
+    //Timeline trace file, empty when not wanted
+    std::string traceFile;
+
+    //Adaptive anti-aliasing: -aa <threshold>, 0 when off
+    float aaThreshold;
+
+    //Region of interest: -roi x,y,w,h (width 0 when not wanted) and the
+    //render to composite it over
+    int roiX;
+    int roiY;
+    int roiWidth;
+    int roiHeight;
+    std::string roiBase;
+
+    //Hardware performance counters around shading and communication
+    bool perf;
+
+    //Ray and intersection counts
+    bool rayStats;
+
+    //Lossless compression of the pixels sent to the master
+    bool compress;
+
+    //Batch mode: the job file, the ranks in each group (0 for all of them)
+    //and the tag added to the file names of the current job
+    std::string batchFile;
+    int packRanks;
+    std::string fileTag;
+
+    //The socket that finished tiles are streamed to, empty when not given
+    std::string liveSocket;
+
+    //Static strips and blocks sized by measured speed, and the file that
+    //the weights are cached in (empty for none)
+    bool weighted;
+    std::string weightsFile;
+
+    //Where the largest-first order of the dynamic queue comes from: "probe"
+    //or a cost grid file; empty for row-major order
+    std::string lptSource;
+
+    //The scene file given with -c, which is also left for the engine
+    std::string sceneFile;
+
+    //Incremental re-render: the scene before the edit and its render, empty
+    //when not wanted
+    std::string incrementalScene;
+    std::string incrementalBase;
+
+    //Checkpoints: the file the finished tiles are saved to and how often,
+    //and the file to resume from; empty when not wanted
+    std::string checkpointFile;
+    double checkpointInterval;
+    std::string resumeFile;
+
+    //raytrace_seq only: the number of rendering threads, 0 when not given,
+    //and the number of threaded renders to compare with one thread
+    int renderThreads;
+    int threadChecks;
+
+} RunOptions;
+
+//The options for this run. These are filled in by parseRunOptions().
+extern RunOptions runOptions;
+
+//This function will parse every option that the engine does not know
+//about and remove it from the argument list so that initialize() only
+//sees the options it expects. Every process should call this before
+//calling initialize().
+//
+//Inputs:
+//    argc - The pointer to the number of input arguments
+//    argv - The pointer to the input arguments
+//    options - The pointer to the RunOptions struct to fill in.
+//
+//Outputs:
+//    true if there was an error in the processing; otherwise, false
+bool parseRunOptions(int* argc, char** argv[], RunOptions* options);
+
+#endif
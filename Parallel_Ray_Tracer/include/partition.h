@@ -0,0 +1,145 @@
+#ifndef __PARTITION_H__
+#define __PARTITION_H__
+
+#include <queue>
+#include <vector>
+#include "RayTrace.h"
+
+//The -p hybrid mode. The engine does not know it (see options.cpp), so it
+//is kept here rather than in PartType and set on the ConfigData after the
+//scene is loaded.
+#define PART_MODE_HYBRID ((PartType)64)
+
+//Define a structure that will be used to hold a dynamic work unit and its
+//index in the grid of units, which the master and the slaves both use to
+//refer to it.
+typedef struct
+{
+    int id;
+    int startRow;
+    int startCol;
+    int blockWidth;
+    int blockHeight;
+} WorkUnit;
+
+//The share of the image that each process of the static strips and blocks
+//modes renders, in proportion to its measured speed (see calibrate.h). It
+//is empty when every process gets the same share.
+extern std::vector<double> rankWeights;
+
+//Define a structure that will be used to find the dynamic units from
+//their index alone. The units are the -bw x -bh blocks of the columns from
+//firstCol to the right edge of the image, numbered in row-major order, so
+//the master and the slaves can both work out the rectangle of a unit
+//without it ever being stored or sent.
+typedef struct
+{
+    int firstCol;
+    int blockWidth;
+    int blockHeight;
+    int width;
+    int height;
+    int unitCols;
+    int count;
+} UnitGrid;
+
+//This function will set up the grid of dynamic units for the columns from
+//firstCol to the right edge of the image.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    firstCol - the first column to cut into units.
+//
+//Outputs:
+//    The grid of units.
+UnitGrid unitGrid(ConfigData* data, int firstCol);
+
+//This function will give the rectangle of one dynamic unit.
+//
+//Inputs:
+//    grid - the grid of units.
+//    index - the unit, from 0 to grid->count - 1. It becomes the id.
+//
+//Outputs:
+//    The unit, cut off at the edges of the image.
+WorkUnit unitAt(const UnitGrid* grid, int index);
+
+//This function will cut the columns from firstCol to the right edge of the
+//image into dynamic work units of the configured block size, in row-major
+//order, and add them to the queue. The units are the ones unitAt() gives.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    firstCol - the first column to cut into units.
+//    queue - the queue that the units are added to.
+//
+//Outputs:
+//    The number of units that were added.
+int createDynamicUnits(ConfigData* data, int firstCol, std::queue<WorkUnit>* queue);
+
+//This function will find the vertical strip that a process renders
+//statically in hybrid mode. The static share is the left part of the
+//image, runOptions.staticFraction of the width, cut into one strip per
+//process. The last process gets the extra columns. The strip may be empty,
+//in which case lastCol is less than firstCol.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    rank - the process to find the strip for.
+//    firstCol - the first column of the strip.
+//    lastCol - the last column of the strip.
+//
+//Outputs:
+//    The first column of the dynamic part of the image.
+int hybridStripColumns(ConfigData* data, int rank, int* firstCol, int* lastCol);
+
+//This function will find the vertical strip that a process renders in the
+//static strips mode. Every process gets the same number of columns and the
+//last one gets the extra columns, unless rankWeights is set, in which case
+//the widths follow the weights and every strip has at least one column.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    rank - the process to find the strip for.
+//    firstCol - the first column of the strip.
+//    lastCol - the last column of the strip.
+//
+//Outputs: None
+void stripColumns(ConfigData* data, int rank, int* firstCol, int* lastCol);
+
+//This function will find the rectangle that a process renders in the
+//static blocks mode. Without rankWeights, these are the equal squares
+//centred in the image, with the edge squares stretched to the borders.
+//With rankWeights, the processes are laid out row by row in a grid of
+//ceil(sqrt(procs)) columns; each row of the grid is as tall as the sum of
+//its weights, and each block in it as wide as its own weight, so the area
+//of every block follows its weight.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    rank - the process to find the block for.
+//    firstRow - the first row of the block.
+//    lastRow - the last row of the block.
+//    firstCol - the first column of the block.
+//    lastCol - the last column of the block.
+//
+//Outputs: None
+void blockBounds(ConfigData* data, int rank, int* firstRow, int* lastRow, int* firstCol, int* lastCol);
+
+//This function returns the number of bands that a static region of
+//numRows rows is rendered and sent in, from -bands.
+int bandCount(int numRows);
+
+//This function will find the rows of one band of a static region. The
+//rows are shared out as evenly as possible.
+//
+//Inputs:
+//    numRows - the number of rows in the region.
+//    band - the band, from 0 to bandCount(numRows) - 1.
+//    first - the first row of the band, counted from the top of the region.
+//    count - the number of rows in the band.
+//
+//Outputs: None
+void bandRows(int numRows, int band, int* first, int* count);
+
+#endif
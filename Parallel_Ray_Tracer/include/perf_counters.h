@@ -0,0 +1,77 @@
+#ifndef __PERF_COUNTERS_H__
+#define __PERF_COUNTERS_H__
+
+//This file holds the hardware counters used by -perf. Each process opens
+//one perf_event_open group (cycles, instructions, LLC misses and branch
+//misses, user space only) and charges what the counters move by to the
+//phase that it is in. The partitioning functions switch to the shading
+//phase around every tile they render; everything else they do between
+//tiles, sending, receiving and waiting, is charged to communication.
+//When the kernel or the machine does not allow counting, -perf only
+//reports why.
+
+//Specify the phases that counts are charged to.
+typedef enum{
+    PERF_SHADE = 0,
+    PERF_COMM = 1,
+    PERF_OFF = 2
+} PerfPhase;
+
+#define PERF_PHASES 2
+#define PERF_EVENTS 4
+
+//Define a structure that will be used to add up the counts. It is all
+//long long so that it can be reduced with MPI_LONG_LONG.
+typedef struct
+{
+    long long counts[PERF_PHASES][PERF_EVENTS];
+
+    //The number of processes that could count each event.
+    long long processes[PERF_EVENTS];
+} PerfStats;
+
+//The counts for this process.
+extern PerfStats perfStats;
+
+//True when the counters are open.
+extern bool perfEnabled;
+
+//This function will open the counter group. Events that the machine does
+//not have are left out; if the cycle counter itself cannot be opened,
+//counting stays off.
+//
+//Inputs: None
+//
+//Outputs:
+//    true if the counters are open; otherwise, false
+bool perfInit();
+
+//This function reads the counters and charges them to the phase that is
+//ending. Use perfPhase() instead.
+//
+//Inputs:
+//    phase - the phase that starts now.
+//
+//Outputs: None
+void perfSwitch(PerfPhase phase);
+
+//This function will switch phases when the counters are open.
+inline void perfPhase(PerfPhase phase)
+{
+    if (perfEnabled) {
+        perfSwitch(phase);
+    }
+}
+
+//This function will print the counts of every phase as rates per pixel,
+//or why this process could not count if no process could.
+//
+//Inputs:
+//    stats - the counts, added up over every process.
+//    pixels - the number of pixels in the image.
+//    processes - the number of processes that ran.
+//
+//Outputs: None
+void printPerfStats(const PerfStats* stats, long long pixels, int processes);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef __PNG_WRITER_H__
+#define __PNG_WRITER_H__
+
+#include <string>
+#include "RayTrace.h"
+
+//This function will save the image to disk as a PNG, the same way that
+//savePixels() does, but the work is split over several threads. The
+//pixels are converted to 8 bit RGB, then the rows are cut into bands
+//and each band is filtered and deflated on its own thread. The deflate
+//streams are joined together into one IDAT stream.
+//
+//Inputs:
+//    filename - the name of the file to write.
+//    pixels - the float pointer that contains all of the pixel data from
+//        shading the scene.
+//    data - The pointer to the ConfigData struct that contains the
+//        scene information.
+//    level - the zlib compression level (0 - 9).
+//    threads - the number of threads to use; 0 uses every core.
+//
+//Outputs:
+//    true if the image was written; otherwise, false
+bool savePixelsParallel(std::string filename, float* pixels, ConfigData* data, int level, int threads);
+
+//This function converts a run of float color values to 8 bit values,
+//clamping them the same way that the engine does when it saves a PNG.
+//
+//Inputs:
+//    out - where count bytes will be written.
+//    in - the count float values to convert.
+//    count - the number of values to convert.
+//
+//Outputs: None
+void floatToRGB8(unsigned char* out, const float* in, int count);
+
+#endif
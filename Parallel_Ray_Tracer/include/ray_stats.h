@@ -0,0 +1,69 @@
+#ifndef __RAY_STATS_H__
+#define __RAY_STATS_H__
+
+#include "RayTrace.h"
+
+//This file holds the ray statistics used by -raystats. RayTrace.h may not
+//be modified and the engine is only shipped as a library, so the only rays
+//that can be counted are the primary ones: shadePixelCosted() counts every
+//call into the engine (anti-aliasing samples included) and the time spent
+//in it. Shadow, reflection and refraction rays and intersection tests
+//happen inside the engine and cannot be seen.
+//
+//The counts are kept per thread and added up over every process.
+
+//Define a structure that will be used to hold the counts. It is all long
+//long so that it can be reduced with MPI_LONG_LONG.
+typedef struct
+{
+    long long primaryRays;
+
+    //Time stamp counter cycles spent in shadePixel() since the last call
+    //to rayStatsCollect(), and the time collected so far.
+    long long shadeCycles;
+    long long shadeNanoseconds;
+} RayStats;
+
+//The counts of this thread.
+extern thread_local RayStats rayStats;
+
+//True when -raystats was given.
+extern bool rayStatsEnabled;
+
+//This function will measure the time stamp counter so that shading time
+//can be turned into seconds, and turn the counting on. Every process must
+//call this before rendering.
+//
+//Inputs: None
+//
+//Outputs: None
+void rayStatsInit();
+
+//This function turns the shading cycles of the calling thread into time. Every thread that rendered must call this
+//once it is done, before its counts are read.
+//
+//Inputs: None
+//
+//Outputs: None
+void rayStatsCollect();
+
+//This function adds one set of counts into another.
+//
+//Inputs:
+//    total - the counts to add to.
+//    stats - the counts to add.
+//
+//Outputs: None
+void rayStatsAdd(RayStats* total, const RayStats* stats);
+
+//This function will print the primary rays per pixel and the rays traced
+//per second of shading.
+//
+//Inputs:
+//    stats - the counts, added up over every process.
+//    pixels - the number of pixels in the image.
+//
+//Outputs: None
+void printRayStats(const RayStats* stats, long long pixels);
+
+#endif
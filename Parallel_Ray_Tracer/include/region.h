@@ -0,0 +1,77 @@
+#ifndef __REGION_H__
+#define __REGION_H__
+
+#include <string>
+#include "RayTrace.h"
+
+//This file holds the region of interest used by -roi. While a region is
+//set, the ConfigData that the partitioning functions see is shrunk to the
+//size of the region, so every scheme splits only the region's pixels over
+//the processes without knowing about it. shadePixelCosted() moves each
+//pixel back to its place in the full frame before calling the engine.
+
+//Define a structure that will be used to hold the region.
+typedef struct
+{
+    bool active;
+    int x;
+    int y;
+
+    //The scene as the engine set it up, with the full image size.
+    ConfigData frame;
+} RenderRegion;
+
+//The region for this run. It is not active unless -roi was given.
+extern RenderRegion renderRegion;
+
+//This function will check the region from -roi against the image and
+//shrink data to it. Every process should call this after initialize().
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//
+//Outputs:
+//    true if the region does not fit in the image; otherwise, false
+bool regionInit(ConfigData* data);
+
+//This function will read an earlier render back as pixels, the way the
+//PNG writers quantized them.
+//
+//Inputs:
+//    file - the PNG to read.
+//    width - the width the PNG must have.
+//    height - the height the PNG must have.
+//    image - filled with the 3 * width * height color values.
+//
+//Outputs:
+//    true if the image was read; otherwise, false
+bool loadRender(std::string file, int width, int height, float* image);
+
+//This function will paste the rendered region into a copy of an existing
+//full size render, for -roi-over.
+//
+//Inputs:
+//    base - the PNG to composite over. It must be the size of the frame.
+//    pixels - the rendered pixels of the region.
+//    data - the ConfigData of the region.
+//    image - filled with the full size image.
+//
+//Outputs:
+//    true if the image was built; otherwise, false
+bool regionComposite(std::string base, const float* pixels, ConfigData* data, float* image);
+
+//This function will save a render as a PNG. The engine's writer always
+//saves the camera's whole frame, so an image the size of the region (with
+//-roi but no -roi-over) is written by the threaded writer, which uses the
+//size in data.
+//
+//Inputs:
+//    file - the name of the file to write.
+//    image - the pixels to save.
+//    data - the ConfigData that gives the size of image.
+//
+//Outputs:
+//    true if the image was written; otherwise, false
+bool regionSavePng(std::string file, float* image, ConfigData* data);
+
+#endif
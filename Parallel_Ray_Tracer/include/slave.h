@@ -9,6 +9,25 @@ void slaveMain( ConfigData *data );
 // void staticStripsHorizontalSlave(ConfigData* data );
 void staticStripsVerticalSlave(ConfigData* data );
 void staticSquareBlocksSlave(ConfigData* data );
-void dynamicSlave(ConfigData* data );
+void slaveStaticCyclesHorizontal(ConfigData* data );
+
+//This function will ask the master for dynamic units and render them until
+//it gets -1. The master sends only the index of a unit; its rectangle comes
+//from unitAt() on the grid of the columns from firstCol.
+void dynamicSlave(ConfigData* data, int firstCol);
+
+//This function will render this process's static strip for -p hybrid,
+//send it to the master, and then work through the dynamic pool.
+void hybridSlave(ConfigData* data );
+
+//This function will receive any cancel messages that the master has sent
+//for speculative units and report whether the given unit was cancelled.
+//
+//Inputs:
+//    unitId - the unit that is being worked on, or -1 for none.
+//
+//Outputs:
+//    true if the master cancelled unitId; otherwise, false
+bool dynamicCancelled(int unitId);
 
 #endif
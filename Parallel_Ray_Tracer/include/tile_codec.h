@@ -0,0 +1,112 @@
+#ifndef __TILE_CODEC_H__
+#define __TILE_CODEC_H__
+
+#include <mpi.h>
+
+//This file holds the lossless codec used by -compress for the pixels that
+//the slaves send to the master. Every message starts with a TileHeader
+//that says which codec was used, so the master can always decode it:
+//
+//    CODEC_SHUFFLE_RLE - each float is replaced by the difference of its
+//        bits from the same channel of the pixel before it, the bytes are
+//        split into four planes (all first bytes, then all second bytes,
+//        ...) and the planes are run-length encoded. Flat background gives
+//        planes of zeros and smooth gradients give mostly zero high bytes,
+//        which both turn into long runs.
+//    CODEC_NONE - the floats as they are, used when encoding does not make
+//        the message smaller.
+//
+//The run-length encoding is PackBits: a control byte c < 128 is followed
+//by c + 1 literal bytes, and c >= 128 by one byte that is repeated c - 125
+//times.
+
+#define CODEC_NONE 0
+#define CODEC_SHUFFLE_RLE 1
+
+//Define a structure that will be used to start every encoded message.
+typedef struct
+{
+    int codec;
+    int rawBytes;
+    int packedBytes;
+} TileHeader;
+
+//Define a structure that will be used to count what the codec did. It is
+//all long long so that it can be reduced with MPI_LONG_LONG.
+typedef struct
+{
+    long long rawBytes;
+    long long packedBytes;
+    long long encodeNanoseconds;
+    long long decodeNanoseconds;
+} CodecStats;
+
+//The counts for this process.
+extern CodecStats codecStats;
+
+//This function returns the size of the largest message that tilePack()
+//can make from count floats.
+//
+//Inputs:
+//    count - the number of floats.
+//
+//Outputs:
+//    The size in bytes.
+int tilePackedCapacity(int count);
+
+//This function will encode floats into a message.
+//
+//Inputs:
+//    values - the floats to encode.
+//    count - the number of floats.
+//    message - filled with the message; tilePackedCapacity(count) bytes.
+//
+//Outputs:
+//    The size of the message in bytes.
+int tilePack(const float* values, int count, unsigned char* message);
+
+//This function will decode a message from tilePack().
+//
+//Inputs:
+//    message - the message.
+//    bytes - the size of the message.
+//    values - filled with the floats.
+//    count - the number of floats expected.
+//
+//Outputs:
+//    true if the message held count floats; otherwise, false
+bool tileUnpack(const unsigned char* message, int bytes, float* values, int count);
+
+//This function sends floats with MPI_Send, encoded when -compress was
+//given.
+//
+//Inputs:
+//    values - the floats to send.
+//    count - the number of floats.
+//    dest - the rank to send to.
+//    tag - the tag of the message.
+//
+//Outputs: None
+void sendTile(const float* values, int count, int dest, int tag);
+
+//This function receives floats sent with sendTile().
+//
+//Inputs:
+//    values - filled with the floats.
+//    count - the number of floats.
+//    source - the rank to receive from.
+//    tag - the tag of the message.
+//
+//Outputs: None
+void recvTile(float* values, int count, int source, int tag);
+
+//This function will print the compression ratio and the time spent in
+//the codec.
+//
+//Inputs:
+//    stats - the counts, added up over every process.
+//
+//Outputs: None
+void printCodecStats(const CodecStats* stats);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef __TILE_RENDER_H__
+#define __TILE_RENDER_H__
+
+#include "RayTrace.h"
+
+//This file holds the threaded renderer used by raytrace_seq -t. The image
+//is cut into square tiles that the threads claim one at a time from an
+//atomic counter, so no locks are taken while rendering. Every pixel is
+//shaded exactly as in the single threaded loop and, with -aa, the tiles
+//are anti-aliased once all of them are shaded, so the image is the same
+//bit for bit.
+//
+//This relies on shadePixel() being safe to call from several threads at
+//once on the same ConfigData. The engine is prebuilt and its source is not
+//available, so that is assumed rather than known: if it kept scratch
+//space, a random number generator or counters in globals, the threads
+//would race on them. -tcheck <runs> checks it for a scene by rendering it
+//with the single threaded loop and then <runs> times on -t threads and
+//comparing every pixel; run it once for every scene before trusting -t
+//timings.
+
+//The width and height of a tile, in pixels.
+#define RENDER_TILE_SIZE 32
+
+//This function will render the whole image with a pool of threads. The
+//calling thread is one of them. The cost grid, anti-aliasing counts and
+//ray counts of the other threads are added into the calling thread's when
+//they finish.
+//
+//Inputs:
+//    pixels - the image, 3 floats per pixel.
+//    data - the ConfigData that holds the scene information.
+//    threads - the number of threads to render with.
+//
+//Outputs: None
+void renderTiles(float* pixels, ConfigData* data, int threads);
+
+//This function will render the whole image on the calling thread, row by
+//row, and then anti-alias it. This is the renderer that raytrace_seq uses
+//without -t.
+//
+//Inputs:
+//    pixels - the image, 3 floats per pixel.
+//    data - the ConfigData that holds the scene information.
+//
+//Outputs: None
+void renderImage(float* pixels, ConfigData* data);
+
+//This function will check that rendering on several threads gives the
+//same image as renderImage(), for -tcheck. The counts and the cost grid are
+//left as they were.
+//
+//Inputs:
+//    pixels - the image that was just rendered on the threads.
+//    data - the ConfigData that holds the scene information.
+//    threads - the number of threads it was rendered with.
+//    runs - the number of threaded renders to compare, that one included.
+//
+//Outputs:
+//    The number of pixels that differed, over every run.
+long long checkTiles(const float* pixels, ConfigData* data, int threads, int runs);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <string>
+#include <mpi.h>
+#include "RayTrace.h"
+
+//This file holds the timeline tracer used by -trace. Every process records
+//what it was doing, and when, into a fixed ring buffer; at the end the
+//buffers are merged into one Chrome trace (JSON) on rank 0, with one track
+//per rank, that can be opened in Perfetto or chrome://tracing. When -trace
+//is not given, recording costs a single test of traceEnabled.
+
+//Specify the kinds of events that are recorded.
+typedef enum{
+    TRACE_SHADE = 0,
+    TRACE_SEND = 1,
+    TRACE_RECV = 2,
+    TRACE_PROBE = 3,
+    TRACE_IDLE = 4,
+    TRACE_SAVE = 5
+} TraceKind;
+
+//True when -trace was given.
+extern bool traceEnabled;
+
+//This function will allocate the ring buffer and line up the clocks of
+//every process with a barrier. Every process must call this.
+//
+//Inputs: None
+//
+//Outputs: None
+void traceInit();
+
+//This function adds one event to the ring buffer. Once it is full, the
+//oldest events are overwritten. It may be called from any thread.
+//
+//Inputs:
+//    kind - what was being done.
+//    start - MPI_Wtime() when it began.
+//    end - MPI_Wtime() when it ended.
+//    peer - the other rank for send, recv and probe; otherwise -1.
+//
+//Outputs: None
+void traceRecord(TraceKind kind, double start, double end, int peer);
+
+//This function returns the time to pass to traceEvent(), or 0 when
+//tracing is off so that no clock is read.
+inline double traceNow()
+{
+    return traceEnabled ? MPI_Wtime() : 0.0;
+}
+
+//This function records an event when tracing is on.
+inline void traceEvent(TraceKind kind, double start, double end, int peer = -1)
+{
+    if (traceEnabled) {
+        traceRecord(kind, start, end, peer);
+    }
+}
+
+//This function will gather the events of every process on rank 0 and
+//write them as a Chrome trace. Every process must call this.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    filename - the file that rank 0 writes.
+//
+//Outputs:
+//    true if the file was written (on rank 0); otherwise, false
+bool traceWrite(ConfigData* data, std::string filename);
+
+#endif
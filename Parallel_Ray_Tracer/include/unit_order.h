@@ -0,0 +1,37 @@
+#ifndef __UNIT_ORDER_H__
+#define __UNIT_ORDER_H__
+
+#include <queue>
+#include <string>
+#include "RayTrace.h"
+#include "partition.h"
+
+//This file holds the largest-first ordering of the dynamic queue used by
+//-lpt. The units are handed out by their estimated cost, most expensive
+//first (longest processing time first), so that a costly tile near the
+//bottom of the image does not start last and hold up the end of the
+//render. The messages to the workers do not change.
+//
+//The estimate comes from one of:
+//    probe - the master shades a few pixels of every unit (2 x 2 points,
+//        fewer for thin units) and times them with the time stamp counter.
+//        This is part of the execution time.
+//    <file>.cost - a grid saved by an earlier run with -costmap. Each unit
+//        gets the cost of the cells it covers, in proportion to how much of
+//        each cell it covers; the grid is stretched over the image if it
+//        was measured at another size.
+
+//This function will reorder the units in the queue from the most to the
+//least expensive, and print how the order was found. The ids of the
+//units do not change. If the estimate cannot be made, the queue is left
+//in row-major order.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//    source - "probe" or the name of a cost grid file.
+//    queue - the units to reorder.
+//
+//Outputs: None
+void orderUnitsByCost(ConfigData* data, std::string source, std::queue<WorkUnit>* queue);
+
+#endif
@@ -70,4 +70,7 @@ spack env activate cmpe-655
 # srun -n $SLURM_NPROCS raytrace_mpi -h 100 -w 100 -c configs/twhitted.xml -p static_blocks 
 # Dynamic
 # srun -n $SLURM_NPROCS raytrace_mpi -h 5000 -w 5000 -c configs/twhitted.xml -p dynamic -bh 7 -bw 13
+# Long renders: save the finished tiles every 5 minutes and when the time
+# limit stops the job, then submit again with -resume to render the rest.
+# srun -n $SLURM_NPROCS raytrace_mpi -h 5000 -w 5000 -c configs/box.xml -p dynamic -bh 70 -bw 1 -checkpoint std/box.ckpt,300 -resume std/box.ckpt
 srun -n $SLURM_NPROCS raytrace_mpi -h 5000 -w 5000 -c configs/box.xml -p dynamic -bh 70 -bw 1
@@ -0,0 +1,221 @@
+//This file contains the process pinning and NUMA placement.
+
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <vector>
+#include "affinity.h"
+
+//From <numaif.h>, which needs libnuma.
+#define MPOL_PREFERRED_POLICY 1
+
+//One hardware thread, as seen in sysfs.
+typedef struct
+{
+    int cpu;
+    int package;
+    int core;
+    int node;
+} CpuInfo;
+
+//The cores that the launcher gave this process, kept from the first call
+//so that widenToNode() still knows them after the process is pinned.
+static cpu_set_t allowedCpus;
+static bool haveAllowed = false;
+
+static int readNumber(const char* path, int fallback)
+{
+    std::ifstream in(path);
+    int value;
+    if (in >> value) {
+        return value;
+    }
+    return fallback;
+}
+
+//Parse a sysfs cpu list such as "0-3,8-11".
+static std::vector<int> readCpuList(const char* path)
+{
+    std::vector<int> cpus;
+    std::ifstream in(path);
+    std::string text;
+    if (!(in >> text)) {
+        return cpus;
+    }
+
+    std::stringstream ranges(text);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        int first, last;
+        if (sscanf(range.c_str(), "%d-%d", &first, &last) != 2) {
+            last = first = atoi(range.c_str());
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+//Read the allowed hardware threads, sorted by socket and then core.
+static std::vector<CpuInfo> readTopology()
+{
+    if (!haveAllowed) {
+        sched_getaffinity(0, sizeof(allowedCpus), &allowedCpus);
+        haveAllowed = true;
+    }
+
+    std::vector<int> nodeOf(CPU_SETSIZE, 0);
+    for (int node = 0; node < 1024; ++node) {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        if (access(path, R_OK) != 0) {
+            if (node > 0) break;
+            continue;
+        }
+        std::vector<int> cpus = readCpuList(path);
+        for (size_t i = 0; i < cpus.size(); ++i) {
+            if (cpus[i] < CPU_SETSIZE) nodeOf[cpus[i]] = node;
+        }
+    }
+
+    std::vector<CpuInfo> topology;
+    std::vector<int> online = readCpuList("/sys/devices/system/cpu/online");
+    for (size_t i = 0; i < online.size(); ++i) {
+        int cpu = online[i];
+        if (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowedCpus)) continue;
+
+        char path[128];
+        CpuInfo info;
+        info.cpu = cpu;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+        info.package = readNumber(path, 0);
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+        info.core = readNumber(path, cpu);
+        info.node = nodeOf[cpu];
+        topology.push_back(info);
+    }
+
+    std::sort(topology.begin(), topology.end(), [](const CpuInfo& a, const CpuInfo& b) {
+        if (a.package != b.package) return a.package < b.package;
+        if (a.core != b.core) return a.core < b.core;
+        return a.cpu < b.cpu;
+    });
+    return topology;
+}
+
+bool bindProcess(BindMode mode, int localRank, std::string* report)
+{
+    std::vector<CpuInfo> topology = readTopology();
+    if (mode == BIND_NONE || topology.empty()) {
+        *report = "not bound";
+        return false;
+    }
+
+    //Group the hardware threads into cores, and the cores into sockets.
+    std::vector< std::vector<int> > cores;
+    std::vector<int> packages;
+    for (size_t i = 0; i < topology.size(); ++i) {
+        if (i == 0 || topology[i].package != topology[i - 1].package || topology[i].core != topology[i - 1].core) {
+            cores.push_back(std::vector<int>());
+            packages.push_back(topology[i].package);
+        }
+        cores.back().push_back(i);
+    }
+
+    int chosen = localRank % cores.size();
+    if (mode == BIND_SCATTER) {
+        std::vector<int> packageIds = packages;
+        packageIds.erase(std::unique(packageIds.begin(), packageIds.end()), packageIds.end());
+        int package = packageIds[localRank % packageIds.size()];
+
+        std::vector<int> inPackage;
+        for (size_t c = 0; c < cores.size(); ++c) {
+            if (packages[c] == package) inPackage.push_back(c);
+        }
+        chosen = inPackage[(localRank / packageIds.size()) % inPackage.size()];
+    }
+
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    std::ostringstream cpus;
+    for (size_t t = 0; t < cores[chosen].size(); ++t) {
+        const CpuInfo& info = topology[cores[chosen][t]];
+        CPU_SET(info.cpu, &mask);
+        cpus << (t > 0 ? "," : "") << info.cpu;
+    }
+
+    const CpuInfo& first = topology[cores[chosen][0]];
+    std::ostringstream text;
+    text << (mode == BIND_COMPACT ? "compact" : "scatter") << ": cpus " << cpus.str()
+         << " (socket " << first.package << ", core " << first.core << ", NUMA node " << first.node << ")";
+    *report = text.str();
+
+    if (sched_setaffinity(0, sizeof(mask), &mask) != 0) {
+        *report += " FAILED";
+        return false;
+    }
+    return true;
+}
+
+void widenToNode()
+{
+    std::vector<CpuInfo> topology = readTopology();
+    int current = sched_getcpu();
+    int node = -1;
+    for (size_t i = 0; i < topology.size(); ++i) {
+        if (topology[i].cpu == current) node = topology[i].node;
+    }
+    if (node < 0) {
+        return;
+    }
+
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (size_t i = 0; i < topology.size(); ++i) {
+        if (topology[i].node == node) CPU_SET(topology[i].cpu, &mask);
+    }
+    sched_setaffinity(0, sizeof(mask), &mask);
+}
+
+void* allocateLocal(size_t bytes)
+{
+    void* memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return NULL;
+    }
+
+    //Prefer the node of the core that this process is running on.
+    std::vector<CpuInfo> topology = readTopology();
+    int current = sched_getcpu();
+    for (size_t i = 0; i < topology.size(); ++i) {
+        if (topology[i].cpu == current) {
+            unsigned long nodemask[16];
+            memset(nodemask, 0, sizeof(nodemask));
+            int node = topology[i].node;
+            if (node < (int)(8 * sizeof(nodemask))) {
+                nodemask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+                syscall(SYS_mbind, memory, bytes, MPOL_PREFERRED_POLICY, nodemask, 8 * sizeof(nodemask), 0);
+            }
+            break;
+        }
+    }
+
+    //First touch, from this process.
+    memset(memory, 0, bytes);
+    return memory;
+}
+
+void freeLocal(void* memory, size_t bytes)
+{
+    if (memory != NULL) {
+        munmap(memory, bytes);
+    }
+}
@@ -0,0 +1,256 @@
+//This file contains the adaptive anti-aliasing.
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <string>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "antialias.h"
+#include "costmap.h"
+#include "options.h"
+#include "region.h"
+
+thread_local AntialiasStats antialiasStats = { 0, 0, 0 };
+ConfigData antialiasFrame;
+
+bool antialiasLoad(int argc, char** argv, const ConfigData* data, ConfigData* frame)
+{
+    //Give the engine the same arguments with the size scaled up.
+    std::vector<std::string> args;
+    for (int i = 0; i < argc; ++i) {
+        if (i + 1 < argc && (strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "-h") == 0)) {
+            ++i;
+            continue;
+        }
+        args.push_back(argv[i]);
+    }
+    std::ostringstream width, height;
+    width << AA_FACTOR * data->width;
+    height << AA_FACTOR * data->height;
+    args.push_back("-w");
+    args.push_back(width.str());
+    args.push_back("-h");
+    args.push_back(height.str());
+
+    std::vector<char*> pointers;
+    for (size_t i = 0; i < args.size(); ++i) {
+        pointers.push_back(&args[i][0]);
+    }
+    pointers.push_back(NULL);
+    int count = args.size();
+    char** values = &pointers[0];
+    if (initialize(&count, &values, frame)) {
+        std::cerr << "ERROR: could not load the scene at " << width.str() << " x " << height.str()
+                  << " for -aa" << std::endl;
+        return true;
+    }
+    frame->mpi_rank = data->mpi_rank;
+    frame->mpi_procs = data->mpi_procs;
+    return false;
+}
+
+void shadeSubPixel(float* color, int row, int column, int subRow, int subColumn)
+{
+    //With -roi the sub-pixel is one of the full frame.
+    int frameRow = renderRegion.active ? row + renderRegion.y : row;
+    int frameColumn = renderRegion.active ? column + renderRegion.x : column;
+    shadeFrameCosted(color, AA_FACTOR * frameRow + subRow, AA_FACTOR * frameColumn + subColumn, &antialiasFrame, row, column);
+}
+
+//Fill count pixels of the border of an apron, step floats apart, from
+//source, or shade them from the pixel at (row, column) on, moving by
+//(rowStep, columnStep), if source is NULL.
+static void fillBorder(float* border, int step, int count, const float* source, int sourceStep,
+                       int row, int column, int rowStep, int columnStep, ConfigData* data)
+{
+    for (int n = 0; n < count; ++n) {
+        float* sample = border + n * step;
+        if (source != NULL) {
+            sample[0] = source[n * sourceStep];
+            sample[1] = source[n * sourceStep + 1];
+            sample[2] = source[n * sourceStep + 2];
+        }
+        else {
+            shadePixelCosted(sample, row + n * rowStep, column + n * columnStep, data);
+            antialiasStats.extraSamples++;
+        }
+    }
+}
+
+//Refine the pixels of a tile that differ from one of their neighbours. The
+//apron is a copy of the tile with a one pixel border, taken before any of
+//it was refined; its corners are not used.
+static void refineTile(float* tile, int stride, int firstRow, int firstCol, int numRows, int numCols,
+                       const std::vector<float>& apron, ConfigData* data)
+{
+    float threshold = runOptions.aaThreshold;
+    int apronWidth = numCols + 2;
+    static const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+    for (int i = 0; i < numRows; ++i) {
+        for (int j = 0; j < numCols; ++j) {
+            //A pixel resumed from a checkpoint was anti-aliased before it
+            //was saved, so it is left alone, and where it is a neighbour its
+            //color from before that is shaded again.
+            if (checkpoint.resumed && checkpointResumed(firstRow + i, firstCol + j)) {
+                continue;
+            }
+
+            const float* center = &apron[3 * ((i + 1) * apronWidth + (j + 1))];
+            bool edge = false;
+            for (int n = 0; n < 4 && !edge; ++n) {
+                const float* neighbour = &apron[3 * ((i + 1 + offsets[n][0]) * apronWidth + (j + 1 + offsets[n][1]))];
+                int row = firstRow + i + offsets[n][0];
+                int col = firstCol + j + offsets[n][1];
+                float unrefined[3];
+                if (checkpoint.resumed && row >= 0 && row < data->height && col >= 0 && col < data->width
+                    && checkpointResumed(row, col)) {
+                    shadePixelAgain(unrefined, row, col, data);
+                    antialiasStats.extraSamples++;
+                    neighbour = unrefined;
+                }
+                for (int k = 0; k < 3; ++k) {
+                    if (std::fabs(center[k] - neighbour[k]) > threshold) {
+                        edge = true;
+                    }
+                }
+            }
+            if (!edge) {
+                continue;
+            }
+
+            float sum[3] = { 0.0f, 0.0f, 0.0f };
+            for (int a = 0; a < AA_FACTOR; ++a) {
+                for (int b = 0; b < AA_FACTOR; ++b) {
+                    float sample[3];
+                    shadeSubPixel(sample, firstRow + i, firstCol + j, a, b);
+                    sum[0] += sample[0];
+                    sum[1] += sample[1];
+                    sum[2] += sample[2];
+                }
+            }
+
+            float* target = &tile[i * stride + 3 * j];
+            target[0] = sum[0] / (AA_FACTOR * AA_FACTOR);
+            target[1] = sum[1] / (AA_FACTOR * AA_FACTOR);
+            target[2] = sum[2] / (AA_FACTOR * AA_FACTOR);
+            antialiasStats.refined++;
+            antialiasStats.extraSamples += AA_FACTOR * AA_FACTOR;
+        }
+    }
+    antialiasStats.pixels += (long long)numRows * numCols;
+}
+
+void antialiasTile(float* tile, int stride, int firstRow, int firstCol, int numRows, int numCols, ConfigData* data)
+{
+    antialiasBand(tile, stride, firstRow, firstCol, numRows, numCols, false, NULL, data);
+}
+
+void antialiasBandRows(int numRows, int* first, int* count)
+{
+    if (runOptions.aaThreshold <= 0.0f) {
+        return;
+    }
+    int end = *first + *count;
+    if (*first > 0) {
+        ++*first;
+    }
+    if (end < numRows) {
+        ++end;
+    }
+    *count = std::max(0, end - *first);
+}
+
+void antialiasBand(float* tile, int stride, int firstRow, int firstCol, int numRows, int numCols,
+                   bool belowShaded, AntialiasCarry* carry, ConfigData* data)
+{
+    if (runOptions.aaThreshold <= 0.0f || numRows <= 0 || numCols <= 0) {
+        return;
+    }
+
+    //Copy the tile with a one pixel border. The border comes from the
+    //neighbouring bands when this process has them, is shaded again when
+    //it does not, and repeats the edge of the image past it.
+    int apronWidth = numCols + 2;
+    std::vector<float> apron(3 * apronWidth * (numRows + 2));
+    for (int i = 0; i < numRows; ++i) {
+        fillBorder(&apron[3 * ((i + 1) * apronWidth + 1)], 3, numCols, tile + i * stride, 3, 0, 0, 0, 0, data);
+    }
+
+    const float* above = NULL;
+    if (firstRow == 0) {
+        above = tile;
+    }
+    else if (carry != NULL && !carry->colors.empty() && carry->row == firstRow - 1) {
+        above = &carry->colors[0];
+    }
+    fillBorder(&apron[3], 3, numCols, above, 3, firstRow - 1, firstCol, 0, 1, data);
+
+    const float* below = NULL;
+    if (firstRow + numRows == data->height) {
+        below = tile + (numRows - 1) * stride;
+    }
+    else if (belowShaded) {
+        below = tile + numRows * stride;
+    }
+    fillBorder(&apron[3 * ((numRows + 1) * apronWidth + 1)], 3, numCols, below, 3, firstRow + numRows, firstCol, 0, 1, data);
+
+    const float* left = firstCol == 0 ? tile : NULL;
+    fillBorder(&apron[3 * apronWidth], 3 * apronWidth, numRows, left, stride, firstRow, firstCol - 1, 1, 0, data);
+    const float* right = firstCol + numCols == data->width ? tile + 3 * (numCols - 1) : NULL;
+    fillBorder(&apron[3 * (2 * apronWidth - 1)], 3 * apronWidth, numRows, right, stride, firstRow, firstCol + numCols, 1, 0, data);
+
+    refineTile(tile, stride, firstRow, firstCol, numRows, numCols, apron, data);
+
+    if (carry != NULL) {
+        carry->row = firstRow + numRows - 1;
+        carry->colors.assign(apron.begin() + 3 * (numRows * apronWidth + 1), apron.begin() + 3 * (numRows * apronWidth + 1 + numCols));
+    }
+}
+
+void antialiasRows(float* pixels, const std::vector<int>& rows, int nextRow, AntialiasCarry* carry, ConfigData* data)
+{
+    size_t first = 0;
+    while (first < rows.size()) {
+        size_t last = first;
+        while (last + 1 < rows.size() && rows[last + 1] == rows[last] + 1) {
+            ++last;
+        }
+        bool belowShaded = last + 1 == rows.size() && nextRow == rows[last] + 1;
+        antialiasBand(pixels + 3 * first * data->width, 3 * data->width, rows[first], 0, last - first + 1, data->width,
+                      belowShaded, carry, data);
+        first = last + 1;
+    }
+}
+
+void antialiasImageTile(float* pixels, const float* unrefined, int firstRow, int firstCol, int numRows, int numCols, ConfigData* data)
+{
+    if (runOptions.aaThreshold <= 0.0f || numRows <= 0 || numCols <= 0) {
+        return;
+    }
+
+    int apronWidth = numCols + 2;
+    std::vector<float> apron(3 * apronWidth * (numRows + 2));
+    for (int i = 0; i < numRows + 2; ++i) {
+        int row = std::max(0, std::min(firstRow + i - 1, data->height - 1));
+        for (int j = 0; j < apronWidth; ++j) {
+            int col = std::max(0, std::min(firstCol + j - 1, data->width - 1));
+            const float* source = &unrefined[3 * (row * data->width + col)];
+            float* sample = &apron[3 * (i * apronWidth + j)];
+            sample[0] = source[0];
+            sample[1] = source[1];
+            sample[2] = source[2];
+        }
+    }
+    refineTile(pixels + 3 * (firstRow * data->width + firstCol), 3 * data->width,
+               firstRow, firstCol, numRows, numCols, apron, data);
+}
+
+void printAntialiasStats(const AntialiasStats* stats)
+{
+    double share = stats->pixels > 0 ? 100.0 * stats->refined / stats->pixels : 0.0;
+    std::cout << "Anti-aliased Pixels: " << stats->refined << " of " << stats->pixels
+              << " (" << share << "%)" << std::endl;
+    std::cout << "Anti-aliasing Extra Samples: " << stats->extraSamples << std::endl;
+}
@@ -0,0 +1,134 @@
+//This file contains the band by band messages of the static modes.
+
+#include <cstring>
+#include <iostream>
+#include "bands.h"
+#include "partition.h"
+#include "buffer_pool.h"
+#include "trace.h"
+#include "options.h"
+#include "tile_codec.h"
+#include "batch.h"
+#include "live_stream.h"
+#include "checkpoint.h"
+
+void postBandReceives(ConfigData* data, BandReceiver* receiver)
+{
+    for (int rank = 1; rank < data->mpi_procs; ++rank) {
+        StaticRegion* region = &receiver->regions[rank];
+        int numRows = region->rows.size();
+        int rowFloats = 3 * region->numCols;
+        float* buffer = poolAcquire((size_t)rowFloats * numRows + 1);
+        receiver->buffers.push_back(buffer);
+        buffer[(size_t)rowFloats * numRows] = 0.0f;
+
+        int bands = bandCount(numRows);
+        for (int band = 0; band < bands; ++band) {
+            int first, count;
+            bandRows(numRows, band, &first, &count);
+            int floats = rowFloats * count + (band == bands - 1 ? 1 : 0);
+
+            MPI_Request request;
+            if (runOptions.compress) {
+                //The message is decoded into place when it arrives.
+                int capacity = tilePackedCapacity(floats);
+                float* message = poolAcquire((capacity + sizeof(float) - 1) / sizeof(float));
+                MPI_Irecv(message, capacity, MPI_BYTE, rank, 100, renderComm, &request);
+                receiver->messages.push_back(message);
+            }
+            else {
+                MPI_Irecv(buffer + (size_t)rowFloats * first, floats, MPI_FLOAT, rank, 100, renderComm, &request);
+            }
+            receiver->requests.push_back(request);
+            receiver->sources.push_back(rank);
+            receiver->bands.push_back(band);
+        }
+    }
+}
+
+double finishBandReceives(ConfigData* data, BandReceiver* receiver, float* pixels, double* communicationTime)
+{
+    int pending = receiver->requests.size();
+    while (pending > 0) {
+        int index;
+        MPI_Status status;
+        double commStart = MPI_Wtime();
+        MPI_Waitany(receiver->requests.size(), &receiver->requests[0], &index, &status);
+        double commEnd = MPI_Wtime();
+        *communicationTime += commEnd - commStart;
+        --pending;
+
+        int rank = receiver->sources[index];
+        traceEvent(TRACE_RECV, commStart, commEnd, rank);
+
+        //Copy the rows of this band into the image.
+        const StaticRegion& region = receiver->regions[rank];
+        float* buffer = receiver->buffers[rank - 1];
+        int first, count;
+        bandRows(region.rows.size(), receiver->bands[index], &first, &count);
+        if (runOptions.compress) {
+            int bytes;
+            MPI_Get_count(&status, MPI_BYTE, &bytes);
+            int floats = 3 * region.numCols * count + (first + count == (int)region.rows.size() ? 1 : 0);
+            if (!tileUnpack((unsigned char*)receiver->messages[index], bytes, buffer + (size_t)3 * region.numCols * first, floats)) {
+                std::cerr << "ERROR: a compressed band from rank " << rank << " could not be decoded" << std::endl;
+                MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+            }
+            poolRelease(receiver->messages[index]);
+        }
+        for (int i = first; i < first + count; ++i) {
+            memcpy(&pixels[3 * ((size_t)region.rows[i] * data->width + region.firstCol)],
+                   &buffer[(size_t)3 * region.numCols * i], 3 * region.numCols * sizeof(float));
+            liveTile(&buffer[(size_t)3 * region.numCols * i], 3 * region.numCols, region.rows[i], region.firstCol, 1, region.numCols);
+            checkpointTile(region.rows[i], region.firstCol, 1, region.numCols);
+        }
+    }
+
+    double computationTime = 0.0;
+    for (int rank = 1; rank < data->mpi_procs; ++rank) {
+        const StaticRegion& region = receiver->regions[rank];
+        computationTime += receiver->buffers[rank - 1][(size_t)3 * region.numCols * region.rows.size()];
+        poolRelease(receiver->buffers[rank - 1]);
+    }
+    receiver->buffers.clear();
+    receiver->requests.clear();
+    receiver->sources.clear();
+    receiver->bands.clear();
+    receiver->messages.clear();
+    return computationTime;
+}
+
+void sendBand(float* region, int rowFloats, int numRows, int band, BandSender* sender)
+{
+    int first, count;
+    bandRows(numRows, band, &first, &count);
+    int floats = rowFloats * count + (band == bandCount(numRows) - 1 ? 1 : 0);
+
+    MPI_Request request;
+    if (runOptions.compress) {
+        int capacity = tilePackedCapacity(floats);
+        float* message = poolAcquire((capacity + sizeof(float) - 1) / sizeof(float));
+        int bytes = tilePack(region + (size_t)rowFloats * first, floats, (unsigned char*)message);
+        MPI_Isend(message, bytes, MPI_BYTE, 0, 100, renderComm, &request);
+        sender->messages.push_back(message);
+    }
+    else {
+        MPI_Isend(region + (size_t)rowFloats * first, floats, MPI_FLOAT, 0, 100, renderComm, &request);
+    }
+    sender->requests.push_back(request);
+}
+
+void finishBandSends(BandSender* sender)
+{
+    double sendStart = traceNow();
+    if (!sender->requests.empty()) {
+        MPI_Waitall(sender->requests.size(), &sender->requests[0], MPI_STATUSES_IGNORE);
+    }
+    traceEvent(TRACE_SEND, sendStart, traceNow(), 0);
+    sender->requests.clear();
+
+    for (size_t i = 0; i < sender->messages.size(); ++i) {
+        poolRelease(sender->messages[i]);
+    }
+    sender->messages.clear();
+}
@@ -0,0 +1,184 @@
+//This file contains the batch mode used by -batch.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <map>
+#include "batch.h"
+#include "antialias.h"
+#include "options.h"
+#include "partition.h"
+
+MPI_Comm renderComm = MPI_COMM_WORLD;
+
+//The scenes loaded so far, by the options that loaded them apart from the
+//partitioning ones (in practice, by -c, -w and -h).
+static std::map<std::string, ConfigData> scenes;
+
+//The copies of the scenes at the larger size of -aa, by the same options.
+static std::map<std::string, ConfigData> antialiasScenes;
+
+bool readBatchJobs(std::string filename, std::vector< std::vector<std::string> >* jobs)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    std::string text;
+    int length = 0;
+    if (rank == 0) {
+        std::ifstream in(filename.c_str());
+        if (in) {
+            std::stringstream contents;
+            contents << in.rdbuf();
+            text = contents.str();
+            length = text.size();
+        }
+        else {
+            std::cerr << "ERROR: the job file (" << filename << ") could not be opened" << std::endl;
+            length = -1;
+        }
+    }
+
+    MPI_Bcast(&length, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (length < 0) {
+        return true;
+    }
+    text.resize(length);
+    if (length > 0) {
+        MPI_Bcast(&text[0], length, MPI_CHAR, 0, MPI_COMM_WORLD);
+    }
+
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::vector<std::string> job;
+        std::string word;
+        while (words >> word) {
+            job.push_back(word);
+        }
+        if (!job.empty()) {
+            jobs->push_back(job);
+        }
+    }
+    return false;
+}
+
+//Set the partitioning options of a job on a copy of a cached scene, the
+//way initialize() would have. The size cannot be set here, as the camera
+//of the scene keeps the size it was loaded with.
+static bool applyJobOptions(const std::vector<std::string>& options, ConfigData* data)
+{
+    static const char* modeNames[] = { "none", "static_strips_horizontal", "static_strips_vertical",
+                                       "static_blocks", "static_cycles_horizontal", "dynamic" };
+    static const PartType modes[] = { PART_MODE_NONE, PART_MODE_STATIC_STRIPS_HORIZONTAL, PART_MODE_STATIC_STRIPS_VERTICAL,
+                                      PART_MODE_STATIC_BLOCKS, PART_MODE_STATIC_CYCLES_HORIZONTAL, PART_MODE_DYNAMIC };
+
+    for (size_t i = 0; i + 1 < options.size(); i += 2) {
+        const std::string& name = options[i];
+        const std::string& value = options[i + 1];
+        if (name == "-p") {
+            bool found = false;
+            for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) {
+                if (value == modeNames[m]) {
+                    data->partitioningMode = modes[m];
+                    found = true;
+                }
+            }
+            if (!found) {
+                std::cerr << "ERROR: unknown partitioning mode " << value << std::endl;
+                return true;
+            }
+            continue;
+        }
+
+        int number = atoi(value.c_str());
+        if (number <= 0) {
+            std::cerr << "ERROR: " << name << " must be positive" << std::endl;
+            return true;
+        }
+        if (name == "-bw") data->dynamicBlockWidth = number;
+        else if (name == "-bh") data->dynamicBlockHeight = number;
+        else data->cycleSize = number;
+    }
+    return false;
+}
+
+bool loadBatchJob(const std::vector<std::string>& launchArgs, const std::vector<std::string>& job, ConfigData* data)
+{
+    std::vector<std::string> args = launchArgs;
+    args.insert(args.end(), job.begin(), job.end());
+    std::vector<char*> pointers;
+    for (size_t i = 0; i < args.size(); ++i) {
+        pointers.push_back(&args[i][0]);
+    }
+    pointers.push_back(NULL);
+
+    int argc = args.size();
+    char** argv = &pointers[0];
+    if (parseRunOptions(&argc, &argv, &runOptions)) {
+        return true;
+    }
+
+    //The scene is identified by every option but the partitioning ones, so
+    //that a sweep over modes loads it once.
+    std::string key;
+    std::vector<std::string> overrides;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "-bw") == 0
+                             || strcmp(argv[i], "-bh") == 0 || strcmp(argv[i], "-cs") == 0)) {
+            overrides.push_back(argv[i]);
+            overrides.push_back(argv[++i]);
+            continue;
+        }
+        key += std::string(argv[i]) + " ";
+    }
+
+    std::map<std::string, ConfigData>::iterator scene = scenes.find(key);
+    if (scene == scenes.end()) {
+        if (initialize(&argc, &argv, data)) {
+            return true;
+        }
+        scenes[key] = *data;
+    }
+    else {
+        *data = scene->second;
+        if (applyJobOptions(overrides, data)) {
+            return true;
+        }
+    }
+
+    if (runOptions.hybrid) {
+        data->partitioningMode = PART_MODE_HYBRID;
+    }
+    MPI_Comm_rank(renderComm, &data->mpi_rank);
+    MPI_Comm_size(renderComm, &data->mpi_procs);
+
+    if (runOptions.aaThreshold > 0.0f) {
+        std::map<std::string, ConfigData>::iterator frame = antialiasScenes.find(key);
+        if (frame == antialiasScenes.end()) {
+            ConfigData loaded;
+            if (antialiasLoad(argc, argv, data, &loaded)) {
+                return true;
+            }
+            frame = antialiasScenes.insert(std::make_pair(key, loaded)).first;
+        }
+        antialiasFrame = frame->second;
+    }
+    return false;
+}
+
+void releaseBatchScenes()
+{
+    for (std::map<std::string, ConfigData>::iterator scene = scenes.begin(); scene != scenes.end(); ++scene) {
+        shutdown(&scene->second);
+    }
+    scenes.clear();
+    for (std::map<std::string, ConfigData>::iterator scene = antialiasScenes.begin(); scene != antialiasScenes.end(); ++scene) {
+        shutdown(&scene->second);
+    }
+    antialiasScenes.clear();
+}
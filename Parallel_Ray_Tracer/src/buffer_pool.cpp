@@ -0,0 +1,54 @@
+//This file contains the pool of MPI-allocated communication buffers.
+
+#include <vector>
+#include <mpi.h>
+#include "buffer_pool.h"
+
+//The smallest size class is 4K; a 5000 x 5000 image fits well under 2^40.
+#define POOL_MIN_SHIFT 12
+#define POOL_CLASSES 40
+
+//Every buffer starts with a header that records its size class. It is a
+//full cache line so that the floats after it stay aligned.
+#define POOL_HEADER 64
+
+static std::vector<void*> freeLists[POOL_CLASSES];
+
+float* poolAcquire(size_t count)
+{
+    size_t bytes = count * sizeof(float) + POOL_HEADER;
+    int sizeClass = 0;
+    while (((size_t)1 << (sizeClass + POOL_MIN_SHIFT)) < bytes) {
+        sizeClass++;
+    }
+
+    void* memory;
+    if (!freeLists[sizeClass].empty()) {
+        memory = freeLists[sizeClass].back();
+        freeLists[sizeClass].pop_back();
+    }
+    else {
+        MPI_Alloc_mem((MPI_Aint)1 << (sizeClass + POOL_MIN_SHIFT), MPI_INFO_NULL, &memory);
+        *(int*)memory = sizeClass;
+    }
+    return (float*)((char*)memory + POOL_HEADER);
+}
+
+void poolRelease(float* buffer)
+{
+    if (buffer == NULL) {
+        return;
+    }
+    void* memory = (char*)buffer - POOL_HEADER;
+    freeLists[*(int*)memory].push_back(memory);
+}
+
+void poolDrain()
+{
+    for (int sizeClass = 0; sizeClass < POOL_CLASSES; ++sizeClass) {
+        for (size_t i = 0; i < freeLists[sizeClass].size(); ++i) {
+            MPI_Free_mem(freeLists[sizeClass][i]);
+        }
+        freeLists[sizeClass].clear();
+    }
+}
@@ -0,0 +1,140 @@
+//This file contains the calibration used by -weighted.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <mpi.h>
+#include "calibrate.h"
+#include "partition.h"
+#include "options.h"
+#include "region.h"
+#include "batch.h"
+
+//Read the weights from the cache. They are only used when the file has a
+//line for every rank and each rank is on the host it was measured on.
+static bool readWeights(std::string filename, const std::vector<std::string>& hosts,
+                        std::vector<double>* weights, std::vector<double>* speeds)
+{
+    std::ifstream in(filename.c_str());
+    if (!in) {
+        return false;
+    }
+
+    int procs = hosts.size();
+    weights->assign(procs, 0.0);
+    speeds->assign(procs, 0.0);
+    std::vector<bool> found(procs, false);
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        int rank;
+        std::string host;
+        double weight, speed;
+        if (!(fields >> rank)) {
+            continue;
+        }
+        if (!(fields >> host >> weight >> speed) || rank < 0 || rank >= procs || host != hosts[rank] || weight <= 0.0) {
+            return false;
+        }
+        (*weights)[rank] = weight;
+        (*speeds)[rank] = speed;
+        found[rank] = true;
+    }
+    for (int r = 0; r < procs; ++r) {
+        if (!found[r]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool writeWeights(std::string filename, const std::vector<std::string>& hosts,
+                         const std::vector<double>& weights, const std::vector<double>& speeds)
+{
+    std::ofstream out(filename.c_str());
+    out << "# rank host weight pixels-per-second, from -weighted" << std::endl;
+    for (size_t r = 0; r < hosts.size(); ++r) {
+        out << r << " " << hosts[r] << " " << weights[r] << " " << speeds[r] << std::endl;
+    }
+    return out.good();
+}
+
+void calibrateRanks(ConfigData* data)
+{
+    int procs = data->mpi_procs;
+    std::vector<double> speeds(procs, 0.0);
+
+    //The cache is only good for the same ranks on the same hosts.
+    char host[MPI_MAX_PROCESSOR_NAME];
+    int length;
+    memset(host, 0, sizeof(host));
+    MPI_Get_processor_name(host, &length);
+    std::vector<char> allHosts(data->mpi_rank == 0 ? sizeof(host) * procs : 1);
+    MPI_Gather(host, sizeof(host), MPI_CHAR, &allHosts[0], sizeof(host), MPI_CHAR, 0, renderComm);
+    std::vector<std::string> hosts;
+    for (int r = 0; data->mpi_rank == 0 && r < procs; ++r) {
+        hosts.push_back(&allHosts[r * sizeof(host)]);
+    }
+
+    int cached = 0;
+    if (data->mpi_rank == 0 && !runOptions.weightsFile.empty()) {
+        cached = readWeights(runOptions.weightsFile, hosts, &rankWeights, &speeds) ? 1 : 0;
+    }
+    MPI_Bcast(&cached, 1, MPI_INT, 0, renderComm);
+
+    if (cached) {
+        rankWeights.resize(procs);
+        MPI_Bcast(&rankWeights[0], procs, MPI_DOUBLE, 0, renderComm);
+    }
+    else {
+        //Everyone shades the same sample at the same time, so a core that
+        //is shared with another job shows up as slower. The engine is called
+        //directly, so that resumed pixels, the cost grid and the ray counts
+        //do not change the timing. The sample covers the whole frame.
+        ConfigData* engine = renderRegion.active ? &renderRegion.frame : data;
+        int samples = 0;
+        float color[3];
+        MPI_Barrier(renderComm);
+        double start = MPI_Wtime();
+        for (int i = 0; i < CALIBRATE_GRID; ++i) {
+            int row = (int)((i + 0.5) * engine->height / CALIBRATE_GRID);
+            for (int j = 0; j < CALIBRATE_GRID; ++j) {
+                int col = (int)((j + 0.5) * engine->width / CALIBRATE_GRID);
+                shadePixel(color, row, col, engine);
+                samples++;
+            }
+        }
+        double speed = samples / std::max(MPI_Wtime() - start, 1e-9);
+        MPI_Allgather(&speed, 1, MPI_DOUBLE, &speeds[0], 1, MPI_DOUBLE, renderComm);
+
+        double total = 0.0;
+        for (int r = 0; r < procs; ++r) {
+            total += speeds[r];
+        }
+        rankWeights.resize(procs);
+        for (int r = 0; r < procs; ++r) {
+            rankWeights[r] = speeds[r] / total;
+        }
+    }
+
+    if (data->mpi_rank == 0) {
+        if (cached) {
+            std::cout << "Rank Weights (from " << runOptions.weightsFile << "):" << std::endl;
+        }
+        else {
+            std::cout << "Rank Weights (calibrated on " << CALIBRATE_GRID * CALIBRATE_GRID << " pixels):" << std::endl;
+        }
+        for (int r = 0; r < procs; ++r) {
+            std::cout << "Rank " << r << " (" << hosts[r] << "): " << rankWeights[r] << " (" << speeds[r]
+                      << " pixels/second)" << std::endl;
+        }
+
+        if (!cached && !runOptions.weightsFile.empty() && !writeWeights(runOptions.weightsFile, hosts, rankWeights, speeds)) {
+            std::cout << "The weights could not be saved to " << runOptions.weightsFile << std::endl;
+        }
+    }
+}
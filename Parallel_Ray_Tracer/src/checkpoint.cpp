@@ -0,0 +1,394 @@
+//This file contains the checkpoints used by -checkpoint and -resume.
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include "checkpoint.h"
+#include "options.h"
+#include "region.h"
+
+Checkpoint checkpoint;
+
+//The file, and the temporary files that it is written to before being
+//renamed, so that a render stopped in the middle of a write still leaves
+//the last good checkpoint. These are made before the render starts, as
+//the SIGTERM handler cannot allocate.
+static std::string checkpointPath;
+static std::string writePath;
+static std::string termPath;
+
+//The -resume file, with the tag of the batch job.
+static std::string resumePath;
+
+//What is being done with the state, so that SIGTERM never writes the file
+//while checkpointTile() is changing it. The handler may run in any thread
+//of the process (MPI starts its own), so blocking the signal in the thread
+//that updates the state would not be enough. The handler writes the file
+//itself when the state is idle; otherwise it leaves terminatePending set
+//and checkpointTile() writes it when it is done.
+enum
+{
+    CHECKPOINT_IDLE,
+    CHECKPOINT_UPDATING,
+    CHECKPOINT_TERMINATING
+};
+static std::atomic<int> checkpointState(CHECKPOINT_IDLE);
+static volatile sig_atomic_t terminatePending = 0;
+
+//Where the image is in the frame, for the header.
+static int frameX;
+static int frameY;
+
+static double now()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static bool tileDone(int tile)
+{
+    return (checkpoint.bitmap[tile / 8] >> (tile % 8)) & 1;
+}
+
+//The pixels of a tile, cut off at the edges of the image.
+static void tileBounds(int tile, int* row, int* col, int* height, int* width)
+{
+    *row = (tile / checkpoint.tileCols) * CHECKPOINT_TILE;
+    *col = (tile % checkpoint.tileCols) * CHECKPOINT_TILE;
+    *height = std::min(CHECKPOINT_TILE, checkpoint.height - *row);
+    *width = std::min(CHECKPOINT_TILE, checkpoint.width - *col);
+}
+
+//Define a structure that will be used to buffer the writes. Only calls
+//that are safe in a signal handler are made while writing.
+typedef struct
+{
+    int fd;
+    bool ok;
+    size_t used;
+    char buffer[1 << 16];
+} Output;
+
+static void flushOutput(Output* out)
+{
+    size_t written = 0;
+    while (out->ok && written < out->used) {
+        ssize_t count = write(out->fd, out->buffer + written, out->used - written);
+        if (count < 0 && errno != EINTR) {
+            out->ok = false;
+        }
+        else if (count > 0) {
+            written += count;
+        }
+    }
+    out->used = 0;
+}
+
+static void put(Output* out, const void* bytes, size_t length)
+{
+    const char* next = (const char*)bytes;
+    while (length > 0) {
+        if (out->used == sizeof(out->buffer)) {
+            flushOutput(out);
+        }
+        size_t count = std::min(length, sizeof(out->buffer) - out->used);
+        memcpy(out->buffer + out->used, next, count);
+        out->used += count;
+        next += count;
+        length -= count;
+    }
+}
+
+//Write the finished tiles to temp and rename it over the checkpoint.
+static bool writeCheckpoint(const char* temp)
+{
+    Output out;
+    out.fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    out.ok = out.fd >= 0;
+    out.used = 0;
+    if (!out.ok) {
+        return false;
+    }
+
+    CheckpointHeader header;
+    memcpy(header.magic, "RTCK", 4);
+    header.width = checkpoint.width;
+    header.height = checkpoint.height;
+    header.x = frameX;
+    header.y = frameY;
+    header.tile = CHECKPOINT_TILE;
+    header.done = checkpoint.doneTiles;
+    put(&out, &header, sizeof(header));
+    put(&out, &checkpoint.bitmap[0], checkpoint.bitmap.size());
+
+    int tiles = checkpoint.tileCols * checkpoint.tileRows;
+    for (int t = 0; t < tiles; ++t) {
+        if (!tileDone(t)) {
+            continue;
+        }
+        int row, col, height, width;
+        tileBounds(t, &row, &col, &height, &width);
+        for (int i = 0; i < height; ++i) {
+            put(&out, checkpoint.pixels + 3 * ((size_t)(row + i) * checkpoint.width + col), 3 * width * sizeof(float));
+        }
+    }
+    flushOutput(&out);
+
+    bool ok = close(out.fd) == 0 && out.ok;
+    if (ok) {
+        ok = rename(temp, checkpointPath.c_str()) == 0;
+    }
+    else {
+        unlink(temp);
+    }
+    return ok;
+}
+
+//Save what is finished and let SIGTERM end the process as it would have.
+//Only the caller that moved the state to CHECKPOINT_TERMINATING may call
+//this.
+static void saveAndTerminate()
+{
+    if (checkpoint.tracking) {
+        writeCheckpoint(termPath.c_str());
+    }
+    signal(SIGTERM, SIG_DFL);
+    raise(SIGTERM);
+}
+
+static void onTerminate(int)
+{
+    terminatePending = 1;
+    int idle = CHECKPOINT_IDLE;
+    if (checkpointState.compare_exchange_strong(idle, CHECKPOINT_TERMINATING)) {
+        saveAndTerminate();
+    }
+}
+
+//Read the tiles of the -resume file.
+static bool readCheckpoint(std::string filename, ConfigData* data)
+{
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if (!in) {
+        //Nothing was saved yet, e.g. in the first job of a series.
+        if (data->mpi_rank == 0) {
+            std::cout << "Resumed Tiles: none, " << filename << " does not exist yet" << std::endl;
+        }
+        return true;
+    }
+    CheckpointHeader header;
+    if (!in.read((char*)&header, sizeof(header)) || memcmp(header.magic, "RTCK", 4) != 0) {
+        std::cerr << "ERROR: " << filename << " is not a checkpoint" << std::endl;
+        return false;
+    }
+    if (header.width != data->width || header.height != data->height || header.x != frameX
+        || header.y != frameY || header.tile != CHECKPOINT_TILE) {
+        std::cerr << "ERROR: " << filename << " is a checkpoint of a " << header.width << " x " << header.height
+                  << " image at (" << header.x << ", " << header.y << "), not of this one" << std::endl;
+        return false;
+    }
+    if (!in.read((char*)&checkpoint.bitmap[0], checkpoint.bitmap.size())) {
+        std::cerr << "ERROR: " << filename << " is cut short" << std::endl;
+        return false;
+    }
+
+    int tiles = checkpoint.tileCols * checkpoint.tileRows;
+    int done = 0;
+    for (int t = 0; t < tiles; ++t) {
+        done += tileDone(t) ? 1 : 0;
+    }
+    if (done != header.done) {
+        std::cerr << "ERROR: " << filename << " is damaged" << std::endl;
+        return false;
+    }
+
+    checkpoint.saved.assign((size_t)done * 3 * CHECKPOINT_TILE * CHECKPOINT_TILE, 0.0f);
+    int index = 0;
+    for (int t = 0; t < tiles; ++t) {
+        if (!tileDone(t)) {
+            continue;
+        }
+        int row, col, height, width;
+        tileBounds(t, &row, &col, &height, &width);
+        float* saved = &checkpoint.saved[(size_t)index * 3 * CHECKPOINT_TILE * CHECKPOINT_TILE];
+        for (int i = 0; i < height; ++i) {
+            if (!in.read((char*)&saved[3 * i * CHECKPOINT_TILE], 3 * width * sizeof(float))) {
+                std::cerr << "ERROR: " << filename << " is cut short" << std::endl;
+                return false;
+            }
+        }
+        checkpoint.savedIndex[t] = index++;
+    }
+
+    checkpoint.doneTiles = done;
+    checkpoint.resumedTiles = done;
+    checkpoint.resumed = done > 0;
+    return true;
+}
+
+bool checkpointInit(ConfigData* data)
+{
+    checkpoint.width = data->width;
+    checkpoint.height = data->height;
+    checkpoint.tileCols = (data->width + CHECKPOINT_TILE - 1) / CHECKPOINT_TILE;
+    checkpoint.tileRows = (data->height + CHECKPOINT_TILE - 1) / CHECKPOINT_TILE;
+    int tiles = checkpoint.tileCols * checkpoint.tileRows;
+    checkpoint.bitmap.assign((tiles + 7) / 8, 0);
+    checkpoint.doneTiles = 0;
+    checkpoint.resumed = false;
+    checkpoint.resumedTiles = 0;
+    checkpoint.savedIndex.assign(tiles, -1);
+    checkpoint.saved.clear();
+    checkpoint.pixels = NULL;
+    checkpoint.tracking = false;
+    checkpoint.filled.clear();
+    checkpoint.interval = runOptions.checkpointInterval;
+    checkpoint.writes = 0;
+    frameX = renderRegion.active ? renderRegion.x : 0;
+    frameY = renderRegion.active ? renderRegion.y : 0;
+    checkpointState.store(CHECKPOINT_IDLE);
+    terminatePending = 0;
+
+    //Every job of a batch gets its own files.
+    resumePath = runOptions.resumeFile + runOptions.fileTag;
+    if (!runOptions.resumeFile.empty() && !readCheckpoint(resumePath, data)) {
+        return true;
+    }
+
+    if (!runOptions.checkpointFile.empty()) {
+        checkpointPath = runOptions.checkpointFile + runOptions.fileTag;
+        writePath = checkpointPath + ".tmp";
+        termPath = checkpointPath + ".term";
+        signal(SIGTERM, data->mpi_rank == 0 ? onTerminate : SIG_IGN);
+    }
+    return false;
+}
+
+void checkpointStart(float* pixels, bool track)
+{
+    checkpoint.pixels = pixels;
+    if (runOptions.checkpointFile.empty() || !track) {
+        return;
+    }
+    checkpoint.filled.assign(checkpoint.tileCols * checkpoint.tileRows, 0);
+    checkpoint.lastWrite = now();
+    checkpoint.tracking = true;
+}
+
+void checkpointFilter(ConfigData* data, std::queue<WorkUnit>* queue)
+{
+    if (!checkpoint.resumed) {
+        return;
+    }
+
+    //The units that are dropped are never sent, so their pixels come from
+    //the checkpoint here.
+    int tiles = checkpoint.tileCols * checkpoint.tileRows;
+    for (int t = 0; t < tiles; ++t) {
+        if (!tileDone(t)) {
+            continue;
+        }
+        int row, col, height, width;
+        tileBounds(t, &row, &col, &height, &width);
+        for (int i = 0; i < height; ++i) {
+            for (int j = 0; j < width; ++j) {
+                checkpointColor(checkpoint.pixels + 3 * ((size_t)(row + i) * data->width + col + j), row + i, col + j);
+            }
+        }
+    }
+
+    int units = queue->size();
+    std::queue<WorkUnit> missing;
+    while (!queue->empty()) {
+        const WorkUnit& unit = queue->front();
+        bool done = true;
+        for (int r = unit.startRow / CHECKPOINT_TILE; done && r <= (unit.startRow + unit.blockHeight - 1) / CHECKPOINT_TILE; ++r) {
+            for (int c = unit.startCol / CHECKPOINT_TILE; done && c <= (unit.startCol + unit.blockWidth - 1) / CHECKPOINT_TILE; ++c) {
+                done = tileDone(r * checkpoint.tileCols + c);
+            }
+        }
+        if (!done) {
+            missing.push(unit);
+        }
+        queue->pop();
+    }
+    *queue = missing;
+    std::cout << "Resumed Units: " << units - queue->size() << " of " << units << " were in the checkpoint" << std::endl;
+}
+
+void checkpointTile(int row, int col, int height, int width)
+{
+    if (!checkpoint.tracking) {
+        return;
+    }
+    int idle = CHECKPOINT_IDLE;
+    if (!checkpointState.compare_exchange_strong(idle, CHECKPOINT_UPDATING)) {
+        //SIGTERM came and the file is being written.
+        return;
+    }
+
+    for (int r = row / CHECKPOINT_TILE; r <= (row + height - 1) / CHECKPOINT_TILE; ++r) {
+        int rows = std::min(row + height, (r + 1) * CHECKPOINT_TILE) - std::max(row, r * CHECKPOINT_TILE);
+        for (int c = col / CHECKPOINT_TILE; c <= (col + width - 1) / CHECKPOINT_TILE; ++c) {
+            int tile = r * checkpoint.tileCols + c;
+            if (tileDone(tile)) {
+                continue;
+            }
+            int cols = std::min(col + width, (c + 1) * CHECKPOINT_TILE) - std::max(col, c * CHECKPOINT_TILE);
+            checkpoint.filled[tile] += rows * cols;
+
+            int tileRow, tileCol, tileHeight, tileWidth;
+            tileBounds(tile, &tileRow, &tileCol, &tileHeight, &tileWidth);
+            if (checkpoint.filled[tile] >= tileHeight * tileWidth) {
+                checkpoint.bitmap[tile / 8] |= 1 << (tile % 8);
+                checkpoint.doneTiles++;
+            }
+        }
+    }
+
+    if (now() - checkpoint.lastWrite >= checkpoint.interval) {
+        if (writeCheckpoint(writePath.c_str())) {
+            checkpoint.writes++;
+        }
+        checkpoint.lastWrite = now();
+    }
+
+    checkpointState.store(CHECKPOINT_IDLE);
+    idle = CHECKPOINT_IDLE;
+    if (terminatePending && checkpointState.compare_exchange_strong(idle, CHECKPOINT_TERMINATING)) {
+        saveAndTerminate();
+    }
+}
+
+void checkpointEnd(ConfigData* data)
+{
+    bool tracked = checkpoint.tracking;
+    checkpoint.tracking = false;
+    checkpoint.pixels = NULL;
+    if (!runOptions.checkpointFile.empty()) {
+        signal(SIGTERM, SIG_DFL);
+    }
+
+    if (data->mpi_rank != 0) {
+        return;
+    }
+    int tiles = checkpoint.tileCols * checkpoint.tileRows;
+    if (checkpoint.resumed) {
+        std::cout << "Resumed Tiles: " << checkpoint.resumedTiles << " of " << tiles << " from "
+                  << resumePath << std::endl;
+    }
+    if (!runOptions.checkpointFile.empty() && !tracked) {
+        std::cout << "Checkpoints: none, as every process writes its own part of the image" << std::endl;
+    }
+    else if (!runOptions.checkpointFile.empty()) {
+        std::cout << "Checkpoints: " << checkpoint.writes << " written to " << checkpointPath << " (every "
+                  << checkpoint.interval << " seconds)" << std::endl;
+    }
+}
@@ -0,0 +1,94 @@
+//This file contains the shading cost grid and its file formats.
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "costmap.h"
+#include "png_writer.h"
+
+thread_local CostMap costMap;
+
+void costMapInit(ConfigData* data, int cols, int rows)
+{
+    costMap.cost.clear();
+    if (cols <= 0 || rows <= 0) {
+        return;
+    }
+
+    //There is no point in cells smaller than a pixel.
+    costMap.cols = std::min(cols, data->width);
+    costMap.rows = std::min(rows, data->height);
+    costMap.width = data->width;
+    costMap.height = data->height;
+    costMap.cost.assign(costMap.cols * costMap.rows, 0.0);
+}
+
+bool costMapWrite(std::string filename, const CostMap* map)
+{
+    FILE* fp = fopen(filename.c_str(), "wb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    int header[4] = { map->cols, map->rows, map->width, map->height };
+    fwrite("COST", 1, 4, fp);
+    fwrite(header, sizeof(int), 4, fp);
+    fwrite(&map->cost[0], sizeof(double), map->cost.size(), fp);
+
+    bool written = !ferror(fp);
+    fclose(fp);
+    return written;
+}
+
+bool costMapRead(std::string filename, CostMap* map)
+{
+    FILE* fp = fopen(filename.c_str(), "rb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    char magic[4];
+    int header[4];
+    bool ok = fread(magic, 1, 4, fp) == 4 && memcmp(magic, "COST", 4) == 0
+           && fread(header, sizeof(int), 4, fp) == 4
+           && header[0] > 0 && header[1] > 0 && header[2] > 0 && header[3] > 0
+           && header[0] <= header[2] && header[1] <= header[3]
+           && (long)header[0] * header[1] <= COST_MAP_MAX_CELLS;
+    if (ok) {
+        map->cols = header[0];
+        map->rows = header[1];
+        map->width = header[2];
+        map->height = header[3];
+        map->cost.resize(map->cols * map->rows);
+        ok = fread(&map->cost[0], sizeof(double), map->cost.size(), fp) == map->cost.size();
+    }
+
+    fclose(fp);
+    return ok;
+}
+
+bool costMapWriteHeatmap(std::string filename, const CostMap* map)
+{
+    //Blow small grids up so that the cells can be seen.
+    int scale = std::max(1, 512 / std::max(map->cols, map->rows));
+    ConfigData image;
+    image.width = map->cols * scale;
+    image.height = map->rows * scale;
+
+    double lowest = *std::min_element(map->cost.begin(), map->cost.end());
+    double highest = *std::max_element(map->cost.begin(), map->cost.end());
+    double range = highest > lowest ? highest - lowest : 1.0;
+
+    std::vector<float> pixels(3 * image.width * image.height);
+    for (int y = 0; y < image.height; ++y) {
+        for (int x = 0; x < image.width; ++x) {
+            double t = (map->cost[(y / scale) * map->cols + (x / scale)] - lowest) / range;
+            float* color = &pixels[3 * (y * image.width + x)];
+            color[0] = (float)std::min(1.0, std::max(0.0, 2.0 * t - 1.0));
+            color[1] = (float)(1.0 - std::abs(2.0 * t - 1.0));
+            color[2] = (float)std::min(1.0, std::max(0.0, 1.0 - 2.0 * t));
+        }
+    }
+
+    return savePixelsParallel(filename, &pixels[0], &image, 6, 1);
+}
@@ -0,0 +1,926 @@
+//This file contains the incremental re-render used by -incremental.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mpi.h>
+#include "incremental.h"
+#include "options.h"
+#include "region.h"
+#include "batch.h"
+
+IncrementalRender incrementalRender;
+
+//Define a structure that will be used to hold an element of an XML file.
+struct XmlElement
+{
+    std::string tag;
+    std::map<std::string, std::string> attributes;
+
+    //The text directly inside the element, such as the path of a model.
+    std::string text;
+    std::vector<XmlElement> children;
+};
+
+typedef struct
+{
+    double x, y, z;
+} Vector;
+
+//Define a structure that will be used to hold an object that the engine
+//loads from a model file, as it is after the matrices of the model.
+typedef struct
+{
+    bool sphere;
+    Vector centre;
+    double radius;
+
+    //True if it reflects or refracts what is around it.
+    bool mirror;
+
+    //The object written out in full, to compare it with the other scene.
+    std::string text;
+} SceneObject;
+
+//Define a structure that will be used to hold a material of an MTL file.
+typedef struct
+{
+    //True if it reflects (Kr) or lets light through (Tf).
+    bool mirror;
+
+    //The material written out in full.
+    std::string text;
+} Material;
+
+//Define a structure that will be used to hold what a scene file sets up.
+typedef struct
+{
+    //The camera, background, lights and illumination models written out,
+    //which must be the same in both scenes.
+    std::string settings;
+
+    Vector eye;
+    Vector lookAt;
+    Vector up;
+    double frameWidth;
+    double frameHeight;
+    double focalDistance;
+
+    std::vector<Vector> lights;
+    std::vector<SceneObject> objects;
+
+    //The plane that every vertex of every triangle mesh lies in, if there
+    //is one, which the shadows end on.
+    bool floor;
+    Vector floorPoint;
+    Vector floorNormal;
+    std::vector<Vector> meshPoints;
+} SceneFile;
+
+//Define a structure that will be used to hold the matrix that a model is
+//moved by, as the rows of an affine transform.
+typedef struct
+{
+    double m[3][4];
+} Transform;
+
+static Vector vector(double x, double y, double z)
+{
+    Vector v = { x, y, z };
+    return v;
+}
+
+static Vector subtract(Vector a, Vector b)
+{
+    return vector(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+static double dot(Vector a, Vector b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static Vector cross(Vector a, Vector b)
+{
+    return vector(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+static Vector normalize(Vector a)
+{
+    double length = sqrt(dot(a, a));
+    return length > 0.0 ? vector(a.x / length, a.y / length, a.z / length) : a;
+}
+
+static std::string vectorText(Vector v)
+{
+    std::ostringstream text;
+    text.precision(9);
+    text << v.x << " " << v.y << " " << v.z;
+    return text.str();
+}
+
+//Read the attributes of a tag, from just after its name up to its '>'.
+//Returns false if they are not of the form name="value".
+static bool readAttributes(const std::string& text, size_t* at, std::map<std::string, std::string>* attributes, bool* closed)
+{
+    size_t i = *at;
+    while (i < text.size()) {
+        while (i < text.size() && isspace((unsigned char)text[i])) {
+            ++i;
+        }
+        if (i < text.size() && text[i] == '>') {
+            *closed = false;
+            *at = i + 1;
+            return true;
+        }
+        if (i + 1 < text.size() && text[i] == '/' && text[i + 1] == '>') {
+            *closed = true;
+            *at = i + 2;
+            return true;
+        }
+
+        size_t nameStart = i;
+        while (i < text.size() && !isspace((unsigned char)text[i]) && text[i] != '=' && text[i] != '>' && text[i] != '/') {
+            ++i;
+        }
+        std::string name = text.substr(nameStart, i - nameStart);
+        while (i < text.size() && isspace((unsigned char)text[i])) {
+            ++i;
+        }
+        if (name.empty() || i >= text.size() || text[i] != '=') {
+            return false;
+        }
+        ++i;
+        while (i < text.size() && isspace((unsigned char)text[i])) {
+            ++i;
+        }
+        if (i >= text.size() || (text[i] != '"' && text[i] != '\'')) {
+            return false;
+        }
+        char quote = text[i++];
+        size_t end = text.find(quote, i);
+        if (end == std::string::npos) {
+            return false;
+        }
+        (*attributes)[name] = text.substr(i, end - i);
+        i = end + 1;
+    }
+    return false;
+}
+
+//Write a tag and its attributes out again, in the order of their names.
+static std::string tagText(const std::string& tag, const std::map<std::string, std::string>& attributes)
+{
+    std::string text = "<" + tag;
+    for (std::map<std::string, std::string>::const_iterator a = attributes.begin(); a != attributes.end(); ++a) {
+        text += " " + a->first + "=\"" + a->second + "\"";
+    }
+    return text + ">";
+}
+
+//Skip a comment or processing instruction at text[*at]. Returns false if
+//there is none there or it is not closed.
+static bool skipMarkup(const std::string& text, size_t* at, bool* ok)
+{
+    const char* end = NULL;
+    if (text.compare(*at, 4, "<!--") == 0) {
+        end = "-->";
+    }
+    else if (text.compare(*at, 2, "<?") == 0) {
+        end = "?>";
+    }
+    if (end == NULL) {
+        return false;
+    }
+    size_t close = text.find(end, *at);
+    *ok = close != std::string::npos;
+    *at = *ok ? close + strlen(end) : text.size();
+    return true;
+}
+
+//Read the children and text of an element whose start tag ends just before
+//text[*at], up to and including its end tag.
+static bool readChildren(const std::string& text, size_t* at, XmlElement* element)
+{
+    size_t i = *at;
+    while (true) {
+        size_t open = text.find('<', i);
+        if (open == std::string::npos) {
+            return false;
+        }
+        element->text += text.substr(i, open - i);
+        i = open;
+
+        bool ok = true;
+        if (skipMarkup(text, &i, &ok)) {
+            if (!ok) {
+                return false;
+            }
+            continue;
+        }
+        if (text.compare(i, 2, "</") == 0) {
+            size_t end = text.find('>', i);
+            if (end == std::string::npos || text.substr(i + 2, end - i - 2) != element->tag) {
+                return false;
+            }
+            *at = end + 1;
+            return true;
+        }
+
+        XmlElement child;
+        size_t nameStart = ++i;
+        while (i < text.size() && !isspace((unsigned char)text[i]) && text[i] != '>' && text[i] != '/') {
+            ++i;
+        }
+        child.tag = text.substr(nameStart, i - nameStart);
+        bool closed;
+        if (child.tag.empty() || !readAttributes(text, &i, &child.attributes, &closed)) {
+            return false;
+        }
+        if (!closed && !readChildren(text, &i, &child)) {
+            return false;
+        }
+        element->children.push_back(child);
+    }
+}
+
+//Read an XML file into its root element.
+static bool readXml(const std::string& filename, XmlElement* root)
+{
+    std::ifstream in(filename.c_str());
+    if (!in) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+
+    XmlElement document;
+    size_t i = 0;
+    if (!readChildren(text + "</>", &i, &document) || document.children.size() != 1) {
+        return false;
+    }
+    *root = document.children[0];
+    return true;
+}
+
+//Write an element and everything in it out again, with its attributes in
+//the order of their names.
+static std::string xmlText(const XmlElement& element)
+{
+    std::string text = tagText(element.tag, element.attributes);
+    for (size_t c = 0; c < element.children.size(); ++c) {
+        text += xmlText(element.children[c]);
+    }
+    std::string inner = element.text;
+    inner.erase(std::remove_if(inner.begin(), inner.end(), ::isspace), inner.end());
+    return text + inner + "</" + element.tag + ">";
+}
+
+static const XmlElement* findChild(const XmlElement* element, const char* tag)
+{
+    if (element == NULL) {
+        return NULL;
+    }
+    for (size_t c = 0; c < element->children.size(); ++c) {
+        if (element->children[c].tag == tag) {
+            return &element->children[c];
+        }
+    }
+    return NULL;
+}
+
+//Find the element of a section, such as a point of <Points>, with an ID.
+static const XmlElement* findID(const XmlElement* section, const std::string& id)
+{
+    if (section == NULL) {
+        return NULL;
+    }
+    for (size_t c = 0; c < section->children.size(); ++c) {
+        std::map<std::string, std::string>::const_iterator a = section->children[c].attributes.find("ID");
+        if (a != section->children[c].attributes.end() && a->second == id) {
+            return &section->children[c];
+        }
+    }
+    return NULL;
+}
+
+static std::string attribute(const XmlElement* element, const char* name)
+{
+    if (element == NULL) {
+        return "";
+    }
+    std::map<std::string, std::string>::const_iterator a = element->attributes.find(name);
+    return a == element->attributes.end() ? "" : a->second;
+}
+
+static double number(const std::string& value, bool* ok)
+{
+    char* end;
+    double result = strtod(value.c_str(), &end);
+    if (end == value.c_str()) {
+        *ok = false;
+    }
+    return result;
+}
+
+//Read the X, Y and Z (or R, G and B) of the element of a section with an ID.
+static Vector sectionValue(const XmlElement* section, const std::string& id, const char* names, bool* ok)
+{
+    const XmlElement* element = findID(section, id);
+    if (element == NULL) {
+        *ok = false;
+        return vector(0.0, 0.0, 0.0);
+    }
+    std::string x(1, names[0]), y(1, names[1]), z(1, names[2]);
+    return vector(number(attribute(element, x.c_str()), ok), number(attribute(element, y.c_str()), ok),
+                  number(attribute(element, z.c_str()), ok));
+}
+
+static Vector applyTransform(const Transform& transform, Vector v)
+{
+    const double (*m)[4] = transform.m;
+    return vector(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z + m[0][3],
+                  m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z + m[1][3],
+                  m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z + m[2][3]);
+}
+
+//Apply a matrix of <Matrices> after the transform so far, the way the
+//engine applies the matrices of a model in the order they are listed.
+static bool applyMatrix(const XmlElement* matrix, Transform* transform)
+{
+    if (matrix == NULL) {
+        return false;
+    }
+    bool ok = true;
+    Transform step = { { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 } } };
+    std::string type = attribute(matrix, "Type");
+    if (type == "Translate" || type == "Scale") {
+        double values[3];
+        const char* axes[3] = { "X", "Y", "Z" };
+        for (int k = 0; k < 3; ++k) {
+            const XmlElement* axis = findChild(matrix, axes[k]);
+            values[k] = number(axis != NULL ? axis->text : "", &ok);
+            if (type == "Translate") {
+                step.m[k][3] = values[k];
+            }
+            else {
+                step.m[k][k] = values[k];
+            }
+        }
+    }
+    else if (type == "RotationX" || type == "RotationY" || type == "RotationZ") {
+        const XmlElement* rotation = findChild(matrix, "Rotation");
+        double angle = number(rotation != NULL ? rotation->text : "", &ok) * M_PI / 180.0;
+        int a = type == "RotationX" ? 1 : (type == "RotationY" ? 2 : 0);
+        int b = (a + 1) % 3;
+        step.m[a][a] = cos(angle);
+        step.m[a][b] = -sin(angle);
+        step.m[b][a] = sin(angle);
+        step.m[b][b] = cos(angle);
+    }
+    else {
+        return false;
+    }
+
+    Transform result;
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            result.m[r][c] = step.m[r][0] * transform->m[0][c] + step.m[r][1] * transform->m[1][c]
+                           + step.m[r][2] * transform->m[2][c] + (c == 3 ? step.m[r][3] : 0.0);
+        }
+    }
+    *transform = result;
+    return ok;
+}
+
+//Read the materials of an MTL file.
+static bool readMaterials(const std::string& filename, std::map<std::string, Material>* materials)
+{
+    std::ifstream in(filename.c_str());
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    Material* material = NULL;
+    while (std::getline(in, line)) {
+        std::istringstream words(line);
+        std::string key;
+        if (!(words >> key)) {
+            continue;
+        }
+        if (key == "newmtl") {
+            std::string name;
+            words >> name;
+            material = &(*materials)[name];
+            material->mirror = false;
+            material->text = "";
+            continue;
+        }
+        if (material == NULL) {
+            continue;
+        }
+        material->text += line + ";";
+        double value;
+        while ((key == "Kr" || key == "Tf") && words >> value) {
+            material->mirror = material->mirror || value > 0.0;
+        }
+    }
+    return true;
+}
+
+//Read the objects of a model's OBJ file: the "type sphere" entries, which
+//the engine reads as an sP and an sR line, and the groups of triangles.
+static bool readObjects(const std::string& path, const Transform& transform, const std::string& model,
+                        bool modelMirror, SceneFile* scene)
+{
+    if (path.size() < 4 || path.compare(path.size() - 4, 4, ".obj") != 0) {
+        return false;
+    }
+    std::ifstream in(path.c_str());
+    if (!in) {
+        return false;
+    }
+
+    std::map<std::string, Material> materials;
+    std::string directory = path.substr(0, path.find_last_of('/') + 1);
+    std::string materialName;
+    std::vector<Vector> vertices;
+    int mesh = -1;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream words(line);
+        std::string key;
+        if (!(words >> key)) {
+            continue;
+        }
+        if (key == "mtllib") {
+            std::string name;
+            words >> name;
+            if (!readMaterials(directory + name, &materials)) {
+                return false;
+            }
+        }
+        else if (key == "usemtl") {
+            words >> materialName;
+            mesh = -1;
+        }
+        else if (key == "g") {
+            mesh = -1;
+        }
+        else if (key == "type") {
+            std::string type, centreLine, radiusLine, centreKey, radiusKey;
+            words >> type;
+            SceneObject sphere;
+            sphere.sphere = true;
+            std::getline(in, centreLine);
+            std::getline(in, radiusLine);
+            std::istringstream centreWords(centreLine), radiusWords(radiusLine);
+            if (type != "sphere" || !(centreWords >> centreKey >> sphere.centre.x >> sphere.centre.y >> sphere.centre.z)
+                || !(radiusWords >> radiusKey >> sphere.radius) || centreKey != "sP" || radiusKey != "sR") {
+                return false;
+            }
+
+            //The engine moves the centre of a sphere but keeps its radius.
+            sphere.centre = applyTransform(transform, sphere.centre);
+            const Material& material = materials[materialName];
+            sphere.mirror = modelMirror || material.mirror;
+            std::ostringstream radius;
+            radius.precision(9);
+            radius << sphere.radius;
+            sphere.text = "sphere " + vectorText(sphere.centre) + " " + radius.str() + " " + model + " " + material.text;
+            scene->objects.push_back(sphere);
+            mesh = -1;
+        }
+        else if (key == "v") {
+            Vector v;
+            if (!(words >> v.x >> v.y >> v.z)) {
+                return false;
+            }
+            vertices.push_back(applyTransform(transform, v));
+            scene->meshPoints.push_back(vertices.back());
+        }
+        else if (key == "f") {
+            if (mesh < 0) {
+                SceneObject triangles;
+                triangles.sphere = false;
+                triangles.mirror = modelMirror || materials[materialName].mirror;
+                triangles.text = "mesh " + model + " " + materials[materialName].text;
+                mesh = scene->objects.size();
+                scene->objects.push_back(triangles);
+            }
+            std::string corner;
+            while (words >> corner) {
+                int index = atoi(corner.c_str());
+                if (index < 1 || index > (int)vertices.size()) {
+                    return false;
+                }
+                scene->objects[mesh].text += " " + vectorText(vertices[index - 1]);
+            }
+            scene->objects[mesh].text += ";";
+        }
+    }
+    return true;
+}
+
+//Find the plane that every vertex of the triangle meshes lies in.
+static void findFloor(SceneFile* scene)
+{
+    scene->floor = false;
+    const std::vector<Vector>& points = scene->meshPoints;
+    if (points.size() < 3) {
+        return;
+    }
+    Vector normal = vector(0.0, 0.0, 0.0);
+    for (size_t i = 1; i + 1 < points.size() && dot(normal, normal) < 1e-12; ++i) {
+        normal = cross(subtract(points[i], points[0]), subtract(points[i + 1], points[0]));
+    }
+    normal = normalize(normal);
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (fabs(dot(normal, subtract(points[i], points[0]))) > 1e-6 * (1.0 + sqrt(dot(points[i], points[i])))) {
+            return;
+        }
+    }
+    scene->floor = dot(normal, normal) > 0.0;
+    scene->floorPoint = points[0];
+    scene->floorNormal = normal;
+}
+
+//Read a scene file the way the engine does, with the model files that it
+//names. Returns false if it cannot be read or holds something that cannot
+//be compared.
+static bool readScene(const std::string& filename, SceneFile* scene)
+{
+    XmlElement root;
+    if (!readXml(filename, &root)) {
+        return false;
+    }
+    const XmlElement* points = findChild(&root, "Points");
+    const XmlElement* vectors = findChild(&root, "Vectors");
+    const XmlElement* colors = findChild(&root, "Colors");
+    const XmlElement* matrices = findChild(&root, "Matrices");
+    const XmlElement* world = findChild(&root, "World");
+    const XmlElement* camera = findChild(&root, "Camera");
+    if (world == NULL || camera == NULL) {
+        return false;
+    }
+
+    //The camera, as the engine builds it.
+    bool ok = true;
+    scene->eye = sectionValue(points, attribute(camera, "EyePoint"), "XYZ", &ok);
+    scene->lookAt = sectionValue(points, attribute(camera, "LookAt"), "XYZ", &ok);
+    scene->up = sectionValue(vectors, attribute(camera, "Up"), "XYZ", &ok);
+    scene->frameWidth = number(attribute(camera, "FrameWidth"), &ok);
+    scene->frameHeight = number(attribute(camera, "FrameHeight"), &ok);
+    scene->focalDistance = number(attribute(camera, "FocalDistance"), &ok);
+    std::ostringstream settings;
+    settings.precision(9);
+    settings << "camera " << vectorText(scene->eye) << " " << vectorText(scene->lookAt) << " " << vectorText(scene->up)
+             << " " << scene->frameWidth << " " << scene->frameHeight << " " << scene->focalDistance << " " << xmlText(*camera);
+    settings << " background " << vectorText(sectionValue(colors, attribute(world, "Background"), "RGB", &ok));
+
+    //The lights, which must all be point lights to bound their shadows.
+    const XmlElement* lights = findChild(world, "Lights");
+    for (size_t l = 0; lights != NULL && l < lights->children.size(); ++l) {
+        const XmlElement* light = &lights->children[l];
+        if (attribute(light, "Type") != "PointLight") {
+            return false;
+        }
+        scene->lights.push_back(sectionValue(points, attribute(light, "Position"), "XYZ", &ok));
+        settings << " light " << vectorText(scene->lights.back());
+        const char* parts[3] = { "Ambient", "Diffuse", "Specular" };
+        for (int p = 0; p < 3; ++p) {
+            settings << " " << vectorText(sectionValue(colors, attribute(light, parts[p]), "RGB", &ok));
+        }
+    }
+
+    //The colors can be used by the illumination models, so any change to
+    //them counts as a change of the settings.
+    const XmlElement* models = findChild(world, "IlluminationModels");
+    settings << " " << (models != NULL ? xmlText(*models) : "") << " " << (colors != NULL ? xmlText(*colors) : "");
+    scene->settings = settings.str();
+
+    const XmlElement* files = findChild(world, "Models");
+    for (size_t m = 0; ok && files != NULL && m < files->children.size(); ++m) {
+        const XmlElement* model = &files->children[m];
+        const XmlElement* path = findChild(model, "Path");
+        if (attribute(model, "Type") != "File" || path == NULL) {
+            return false;
+        }
+
+        Transform transform = { { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 } } };
+        const XmlElement* apply = findChild(model, "ApplyMatrices");
+        for (size_t a = 0; apply != NULL && a < apply->children.size(); ++a) {
+            if (!applyMatrix(findID(matrices, attribute(&apply->children[a], "ID")), &transform)) {
+                return false;
+            }
+        }
+
+        //The properties of the model can make all of its objects mirrors.
+        const XmlElement* properties = findChild(model, "Properties");
+        bool modelMirror = false;
+        const char* filters[2] = { "ReflectionFilter", "RefractionFilter" };
+        for (int f = 0; f < 2; ++f) {
+            const XmlElement* filter = findChild(properties, filters[f]);
+            if (filter != NULL && !filter->attributes.empty()) {
+                Vector color = sectionValue(colors, filter->attributes.begin()->second, "RGB", &ok);
+                modelMirror = modelMirror || color.x > 0.0 || color.y > 0.0 || color.z > 0.0;
+            }
+        }
+
+        std::string file = path->text;
+        file.erase(std::remove_if(file.begin(), file.end(), ::isspace), file.end());
+        std::string description = attribute(model, "IlluminationModel") + (properties != NULL ? xmlText(*properties) : "");
+        ok = ok && readObjects(file, transform, description, modelMirror, scene);
+    }
+    findFloor(scene);
+    return ok && scene->frameWidth > 0.0 && scene->frameHeight > 0.0 && scene->focalDistance > 0.0;
+}
+
+//Define a structure that will be used to project points of the scene into
+//the image, with the engine's pinhole camera.
+typedef struct
+{
+    Vector eye;
+    Vector forward;
+    Vector right;
+    Vector up;
+
+    //The pixels per unit of the view plane, and its distance from the eye.
+    double scaleX;
+    double scaleY;
+    double focalDistance;
+    int width;
+    int height;
+
+    //The pixels that the points fall in so far.
+    double minX, maxX, minY, maxY;
+    bool any;
+} Projection;
+
+//Set up the camera of a scene. The engine's view plane is FrameWidth x
+//FrameHeight at FocalDistance from the eye, spread over -w x -h pixels,
+//with the image's right along forward x up and its top along up.
+static bool cameraProjection(const SceneFile& scene, ConfigData* data, Projection* projection)
+{
+    projection->eye = scene.eye;
+    projection->forward = normalize(subtract(scene.lookAt, scene.eye));
+    projection->right = normalize(cross(projection->forward, scene.up));
+    projection->up = cross(projection->right, projection->forward);
+    projection->scaleX = data->width / scene.frameWidth;
+    projection->scaleY = data->height / scene.frameHeight;
+    projection->focalDistance = scene.focalDistance;
+    projection->width = data->width;
+    projection->height = data->height;
+    projection->any = false;
+    return dot(projection->forward, projection->forward) > 0.0 && dot(projection->right, projection->right) > 0.0;
+}
+
+//Add a point of the scene to the bounds. Returns false if it is not in
+//front of the camera.
+static bool project(Projection* projection, Vector point)
+{
+    Vector offset = subtract(point, projection->eye);
+    double depth = dot(offset, projection->forward);
+    if (depth <= 1e-6) {
+        return false;
+    }
+    double column = projection->width / 2.0
+                  + projection->focalDistance * dot(offset, projection->right) / depth * projection->scaleX;
+    double row = projection->height / 2.0
+               - projection->focalDistance * dot(offset, projection->up) / depth * projection->scaleY;
+    if (!projection->any) {
+        projection->minX = projection->maxX = column;
+        projection->minY = projection->maxY = row;
+        projection->any = true;
+    }
+    projection->minX = std::min(projection->minX, column);
+    projection->maxX = std::max(projection->maxX, column);
+    projection->minY = std::min(projection->minY, row);
+    projection->maxY = std::max(projection->maxY, row);
+    return true;
+}
+
+//Add the corners of the box around a sphere to the bounds and, for every
+//light, where the light casts them onto the floor. Anything the sphere
+//shades lies between the two, above the floor. Returns false if that
+//cannot be bounded.
+static bool projectSphere(Projection* projection, const SceneObject& sphere, const SceneFile& scene)
+{
+    if (sphere.radius < 0.0 || (!scene.lights.empty() && !scene.floor)) {
+        return false;
+    }
+
+    for (int corner = 0; corner < 8; ++corner) {
+        Vector point = vector(sphere.centre.x + ((corner & 1) ? sphere.radius : -sphere.radius),
+                              sphere.centre.y + ((corner & 2) ? sphere.radius : -sphere.radius),
+                              sphere.centre.z + ((corner & 4) ? sphere.radius : -sphere.radius));
+        if (!project(projection, point)) {
+            return false;
+        }
+
+        //The shadow runs from the corner away from the light until it
+        //meets the floor, which has to be beyond the corner.
+        for (size_t l = 0; l < scene.lights.size(); ++l) {
+            Vector ray = subtract(point, scene.lights[l]);
+            double along = dot(scene.floorNormal, ray);
+            if (fabs(along) < 1e-9) {
+                return false;
+            }
+            double t = dot(scene.floorNormal, subtract(scene.floorPoint, scene.lights[l])) / along;
+            if (t < 1.0) {
+                return false;
+            }
+            Vector shadow = vector(scene.lights[l].x + t * ray.x, scene.lights[l].y + t * ray.y, scene.lights[l].z + t * ray.z);
+            if (!project(projection, shadow)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//Mark every unit that the bounds, with the margin, touch.
+static void markBounds(ConfigData* data, int unitCols, const Projection* projection, std::vector<char>* dirty)
+{
+    if (!projection->any) {
+        return;
+    }
+    double left = std::max(projection->minX - INCREMENTAL_MARGIN, 0.0);
+    double right = std::min(projection->maxX + INCREMENTAL_MARGIN, data->width - 1.0);
+    double top = std::max(projection->minY - INCREMENTAL_MARGIN, 0.0);
+    double bottom = std::min(projection->maxY + INCREMENTAL_MARGIN, data->height - 1.0);
+    if (left > right || top > bottom) {
+        return;
+    }
+    for (int r = (int)top / data->dynamicBlockHeight; r <= (int)bottom / data->dynamicBlockHeight; ++r) {
+        for (int c = (int)left / data->dynamicBlockWidth; c <= (int)right / data->dynamicBlockWidth; ++c) {
+            (*dirty)[r * unitCols + c] = 1;
+        }
+    }
+}
+
+//Find the objects of one scene that are not in the other, counting
+//repeats.
+static std::vector<const SceneObject*> missingFrom(const SceneFile& scene, const SceneFile& other)
+{
+    std::map<std::string, int> counts;
+    for (size_t o = 0; o < other.objects.size(); ++o) {
+        counts[other.objects[o].text]++;
+    }
+    std::vector<const SceneObject*> missing;
+    for (size_t o = 0; o < scene.objects.size(); ++o) {
+        int* count = &counts[scene.objects[o].text];
+        if (*count > 0) {
+            --*count;
+        }
+        else {
+            missing.push_back(&scene.objects[o]);
+        }
+    }
+    return missing;
+}
+
+//Find the dirty units from the two scenes. Returns why every unit has to be
+//rendered, or an empty string if the dirty units were found.
+static std::string findDirtyUnits(ConfigData* data, const SceneFile& before, const SceneFile& after, std::vector<char>* dirty)
+{
+    int unitCols = (data->width + data->dynamicBlockWidth - 1) / data->dynamicBlockWidth;
+    if (before.settings != after.settings) {
+        return "the camera, background, lights, colors or illumination models changed";
+    }
+
+    std::vector<const SceneObject*> removed = missingFrom(before, after);
+    std::vector<const SceneObject*> added = missingFrom(after, before);
+    incrementalRender.changed = removed.size() + added.size();
+    if (incrementalRender.changed == 0) {
+        return "";
+    }
+
+    //Every changed object must be a sphere, each bounded in the scene it
+    //is in; the camera and lights are the same in both.
+    const SceneFile* scenes[2] = { &before, &after };
+    const std::vector<const SceneObject*>* changed[2] = { &removed, &added };
+    for (int s = 0; s < 2; ++s) {
+        for (size_t o = 0; o < changed[s]->size(); ++o) {
+            const SceneObject& object = *(*changed[s])[o];
+            if (!object.sphere) {
+                return "a triangle mesh changed";
+            }
+            Projection projection;
+            if (!cameraProjection(*scenes[s], data, &projection) || !projectSphere(&projection, object, *scenes[s])) {
+                return "a changed sphere cannot be bounded in the image";
+            }
+            markBounds(data, unitCols, &projection, dirty);
+        }
+    }
+
+    //Any mirror or glass object can show the change.
+    for (int s = 0; s < 2; ++s) {
+        for (size_t o = 0; o < scenes[s]->objects.size(); ++o) {
+            const SceneObject& object = scenes[s]->objects[o];
+            if (!object.mirror) {
+                continue;
+            }
+            if (!object.sphere) {
+                return "a triangle mesh reflects or refracts the change";
+            }
+            Projection projection;
+            bool ok = cameraProjection(*scenes[s], data, &projection);
+            for (int corner = 0; ok && corner < 8; ++corner) {
+                ok = project(&projection, vector(object.centre.x + ((corner & 1) ? object.radius : -object.radius),
+                                                 object.centre.y + ((corner & 2) ? object.radius : -object.radius),
+                                                 object.centre.z + ((corner & 4) ? object.radius : -object.radius)));
+            }
+            if (!ok) {
+                return "a mirror or glass sphere cannot be bounded in the image";
+            }
+            markBounds(data, unitCols, &projection, dirty);
+        }
+    }
+    return "";
+}
+
+bool incrementalInit(ConfigData* data)
+{
+    incrementalRender.active = false;
+    incrementalRender.dirty.clear();
+    incrementalRender.changed = 0;
+    incrementalRender.fallback = "";
+    if (runOptions.incrementalScene.empty()) {
+        return false;
+    }
+
+    if (data->partitioningMode != PART_MODE_DYNAMIC) {
+        if (data->mpi_rank == 0) {
+            std::cerr << "ERROR: -incremental needs -p dynamic" << std::endl;
+        }
+        return true;
+    }
+    if (renderRegion.active) {
+        if (data->mpi_rank == 0) {
+            std::cerr << "ERROR: -incremental cannot be used with -roi" << std::endl;
+        }
+        return true;
+    }
+
+    //Only the master uses the dirty units.
+    int failed = 0;
+    if (data->mpi_rank == 0) {
+        int unitCols = (data->width + data->dynamicBlockWidth - 1) / data->dynamicBlockWidth;
+        int unitRows = (data->height + data->dynamicBlockHeight - 1) / data->dynamicBlockHeight;
+        std::vector<char> dirty(unitCols * unitRows, 0);
+
+        std::ifstream exists(runOptions.incrementalScene.c_str());
+        SceneFile before, after;
+        if (!exists) {
+            std::cerr << "ERROR: the scene before the edit (" << runOptions.incrementalScene << ") could not be read" << std::endl;
+            failed = 1;
+        }
+        else if (!readScene(runOptions.incrementalScene, &before) || !readScene(runOptions.sceneFile, &after)) {
+            incrementalRender.fallback = "a scene or one of its model files could not be read, or holds more than spheres, triangle meshes and point lights";
+        }
+        else {
+            incrementalRender.fallback = findDirtyUnits(data, before, after, &dirty);
+        }
+        if (!incrementalRender.fallback.empty()) {
+            dirty.assign(dirty.size(), 1);
+        }
+        incrementalRender.dirty.swap(dirty);
+    }
+    MPI_Bcast(&failed, 1, MPI_INT, 0, renderComm);
+    incrementalRender.active = !failed;
+    return failed != 0;
+}
+
+void incrementalFilter(ConfigData* data, float* pixels, std::queue<WorkUnit>* queue)
+{
+    int units = queue->size();
+    if (!incrementalRender.fallback.empty()) {
+        std::cout << "Incremental Render: " << incrementalRender.fallback << ", so every unit is rendered" << std::endl;
+        return;
+    }
+    if (!loadRender(runOptions.incrementalBase, data->width, data->height, pixels)) {
+        std::cout << "Incremental Render: the render before the edit could not be read, so every unit is rendered" << std::endl;
+        return;
+    }
+
+    std::queue<WorkUnit> dirtyUnits;
+    while (!queue->empty()) {
+        if (incrementalRender.dirty[queue->front().id]) {
+            dirtyUnits.push(queue->front());
+        }
+        queue->pop();
+    }
+    *queue = dirtyUnits;
+
+    std::cout << "Incremental Render: " << queue->size() << " of " << units << " units dirty ("
+              << incrementalRender.changed << " scene objects changed)" << std::endl;
+}
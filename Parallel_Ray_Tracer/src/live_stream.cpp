@@ -0,0 +1,133 @@
+//This file contains the live stream used by -live.
+
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "live_stream.h"
+#include "png_writer.h"
+#include "region.h"
+
+LiveStats liveStats = { 0, 0 };
+
+static int liveFd = -1;
+static struct sockaddr_un liveAddress;
+static LiveHeader frameHeader;
+static LiveHeader pendingHeader;
+static std::vector<unsigned char> pending(LIVE_MAX_DATAGRAM);
+
+//Send one datagram without waiting; a full or missing viewer drops it.
+static void sendDatagram(const unsigned char* message, int bytes)
+{
+    ssize_t sent = sendto(liveFd, message, bytes, MSG_DONTWAIT | MSG_NOSIGNAL,
+                          (struct sockaddr*)&liveAddress, sizeof(liveAddress));
+    liveStats.datagrams++;
+    if (sent != bytes) {
+        liveStats.dropped++;
+    }
+}
+
+static void sendMarker(int kind)
+{
+    LiveHeader header = frameHeader;
+    header.kind = kind;
+    sendDatagram((const unsigned char*)&header, sizeof(header));
+}
+
+bool liveOpen(std::string path, ConfigData* data)
+{
+    memset(&liveStats, 0, sizeof(liveStats));
+    if (path.size() >= sizeof(liveAddress.sun_path)) {
+        std::cerr << "ERROR: the socket path (" << path << ") is too long" << std::endl;
+        return false;
+    }
+
+    liveFd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (liveFd < 0) {
+        std::cerr << "ERROR: the live stream socket could not be created" << std::endl;
+        return false;
+    }
+    memset(&liveAddress, 0, sizeof(liveAddress));
+    liveAddress.sun_family = AF_UNIX;
+    strcpy(liveAddress.sun_path, path.c_str());
+
+    //Tiles are placed in the full frame.
+    const ConfigData* frame = renderRegion.active ? &renderRegion.frame : data;
+    memset(&frameHeader, 0, sizeof(frameHeader));
+    frameHeader.magic = LIVE_MAGIC;
+    frameHeader.frameWidth = frame->width;
+    frameHeader.frameHeight = frame->height;
+    pendingHeader.height = 0;
+    sendMarker(LIVE_BEGIN);
+    return true;
+}
+
+//Send the rows that are waiting to be joined with the next ones.
+static void flushPending()
+{
+    if (pendingHeader.height > 0) {
+        memcpy(&pending[0], &pendingHeader, sizeof(pendingHeader));
+        sendDatagram(&pending[0], sizeof(pendingHeader) + 3 * pendingHeader.width * pendingHeader.height);
+        pendingHeader.height = 0;
+    }
+}
+
+void liveTile(const float* pixels, int stride, int row, int col, int height, int width)
+{
+    if (liveFd < 0) {
+        return;
+    }
+    if (renderRegion.active) {
+        row += renderRegion.y;
+        col += renderRegion.x;
+    }
+
+    //Cut the tile into pieces that fit in a datagram. Rows that carry on
+    //from the ones before, as the bands of the static modes do, are
+    //joined into one datagram so that the viewer gets fewer of them.
+    int pixelRoom = (LIVE_MAX_DATAGRAM - sizeof(LiveHeader)) / 3;
+    int pieceCols = width < pixelRoom ? width : pixelRoom;
+    for (int c = 0; c < width; c += pieceCols) {
+        int pieceWidth = width - c < pieceCols ? width - c : pieceCols;
+        for (int r = 0; r < height; ++r) {
+            bool follows = pendingHeader.height > 0 && pendingHeader.x == col + c && pendingHeader.width == pieceWidth
+                           && pendingHeader.y + pendingHeader.height == row + r
+                           && (pendingHeader.height + 1) * pieceWidth <= pixelRoom;
+            if (!follows) {
+                flushPending();
+                pendingHeader = frameHeader;
+                pendingHeader.kind = LIVE_TILE;
+                pendingHeader.x = col + c;
+                pendingHeader.y = row + r;
+                pendingHeader.width = pieceWidth;
+                pendingHeader.height = 0;
+            }
+            floatToRGB8(&pending[sizeof(LiveHeader) + 3 * pieceWidth * pendingHeader.height],
+                        pixels + (size_t)stride * r + 3 * c, 3 * pieceWidth);
+            pendingHeader.height++;
+        }
+    }
+
+    //A tile on its own is sent now; rows wait for the next ones.
+    if (height > 1) {
+        flushPending();
+    }
+}
+
+void liveClose()
+{
+    if (liveFd < 0) {
+        return;
+    }
+    flushPending();
+    sendMarker(LIVE_END);
+    close(liveFd);
+    liveFd = -1;
+}
+
+void printLiveStats(const LiveStats* stats)
+{
+    std::cout << "Live Stream: " << stats->datagrams << " datagrams, " << stats->dropped << " dropped" << std::endl;
+}
@@ -6,37 +6,138 @@
 #include <iostream>
 #include <ctime>
 #include <string>
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include <algorithm>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <mpi.h>
 using namespace std;
 
 #include "RayTrace.h"
 #include "master.h"
 #include "slave.h"
+#include "options.h"
+#include "mpi_output.h"
+#include "affinity.h"
+#include "buffer_pool.h"
+#include "costmap.h"
+#include "trace.h"
+#include "region.h"
+#include "perf_counters.h"
+#include "ray_stats.h"
+#include "antialias.h"
+#include "tile_codec.h"
+#include "batch.h"
+#include "calibrate.h"
+#include "partition.h"
+#include "incremental.h"
+#include "checkpoint.h"
 
-int main( int argc, char* argv[] ) 
+//This function will check for -t and -tcheck, which only raytrace_seq uses.
+//
+//Inputs: None
+//
+//Outputs:
+//    true if -t was given; otherwise, false
+static bool threadsUnused()
 {
-    //Keep the data that will be used for the scene.
-    MPI_Init(&argc, &argv);
-    ConfigData data;
+    if( runOptions.renderThreads > 0 )
+    {
+        cerr << "ERROR: -t and -tcheck are only used by raytrace_seq" << endl;
+        return true;
+    }
+    return false;
+}
 
-    MPI_Comm_rank(MPI_COMM_WORLD, &data.mpi_rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &data.mpi_procs);
-    
-    //Try to initialize the scene.
-    bool result = initialize(&argc, &argv, &data);
-    //Make sure that the initialization was completed.	
-    if( result )
+//Where every process was pinned, gathered on rank 0 for the first summary.
+static char* bindings = NULL;
+static const int bindingSize = 256;
+
+//This function will render one image on renderComm with the options in
+//runOptions.
+//
+//Inputs:
+//    data - the ConfigData that holds the scene information.
+//
+//Outputs:
+//    true if there was an error in the processing; otherwise, false
+static bool renderJob(ConfigData* data)
+{
+    //The summary comes before regionInit(), so that it always gives the
+    //size of the whole image.
+    if( data->mpi_rank == 0 )
     {
-        MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+        //Print a summary of the number of processes, width, height, and partitioning scheme.
+        //DO NOT CHANGE ANYTHING IN THIS SECTION!!!
+        std::cout << "Scene: " << data->sceneID << std::endl; 
+        std::cout << "Width x Height: " << data->width << " x " << data->height << std::endl;
+        std::cout << "Partitioning scheme: " << data->partitioningMode << std::endl;
+        std::cout << "Number of Processes: " << data->mpi_procs << std::endl;
+        //Print out the other properties as well
+        std::cout << "Dynamic block size: " << data->dynamicBlockWidth << " x " << data->dynamicBlockHeight << std::endl;
+        std::cout << "Cycle Size: " << data->cycleSize << std::endl; 
+
+        //-p hybrid is passed to the engine as dynamic (see options.cpp), so
+        //the scheme above is PART_MODE_HYBRID (64), not PART_MODE_DYNAMIC.
+        if( runOptions.hybrid )
+        {
+            std::cout << "Hybrid static fraction: " << runOptions.staticFraction << std::endl;
+        }
     }
 
-    //MPI Intialization
-    // MPI_Init(&argc, &argv);
-    // MPI_Comm_rank(MPI_COMM_WORLD, &data.mpi_rank);
-    // MPI_Comm_size(MPI_COMM_WORLD, &data.mpi_procs);
+    //From here on, data describes only the region of interest.
+    if( regionInit(data) )
+    {
+        return true;
+    }
+
+    //Find the units that an edit of the scene can have changed.
+    if( incrementalInit(data) )
+    {
+        return true;
+    }
+
+    //Pick up the tiles of a render that was stopped. Every process reads
+    //the file, so all of them must be able to.
+    int failed = checkpointInit(data) ? 1 : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, renderComm);
+    if( failed )
+    {
+        return true;
+    }
+
+    //Size the static regions by the speed of each process.
+    rankWeights.clear();
+    if( runOptions.weighted && (data->partitioningMode == PART_MODE_STATIC_STRIPS_VERTICAL
+                                || data->partitioningMode == PART_MODE_STATIC_BLOCKS) )
+    {
+        calibrateRanks(data);
+    }
+
+    //Start every count from zero, as a batch renders many images.
+    costMapInit(data, runOptions.costCols, runOptions.costRows);
+    memset(&antialiasStats, 0, sizeof(antialiasStats));
+    memset(&codecStats, 0, sizeof(codecStats));
+    perfEnabled = false;
+    if( runOptions.perf )
+    {
+        perfInit();
+    }
+    rayStatsEnabled = false;
+    if( runOptions.rayStats )
+    {
+        rayStatsInit();
+    }
+
+    //Every process needs the name of the file when it writes its own part.
+    if( runOptions.outputFormat != OUTPUT_PNG )
+    {
+        runOptions.outputFile = shareOutputFileName(data, runOptions.outputFormat);
+    }
 
-    if( data.mpi_rank == 0 )
+    if( data->mpi_rank == 0 )
     {
         //Create the output directory where all of the renders will be saved.
         struct stat stat_buf;
@@ -52,30 +153,257 @@ int main( int argc, char* argv[] )
             }
         }
 
-        //Print a summary of the number of processes, width, height, and partitioning scheme.
-        //DO NOT CHANGE ANYTHING IN THIS SECTION!!!
-        std::cout << "Scene: " << data.sceneID << std::endl; 
-        std::cout << "Width x Height: " << data.width << " x " << data.height << std::endl;
-        std::cout << "Partitioning scheme: " << data.partitioningMode << std::endl;
-        std::cout << "Number of Processes: " << data.mpi_procs << std::endl;
-        //Print out the other properties as well
-        std::cout << "Dynamic block size: " << data.dynamicBlockWidth << " x " << data.dynamicBlockHeight << std::endl;
-        std::cout << "Cycle Size: " << data.cycleSize << std::endl; 
+        //The size of the region of interest, after the summary of the
+        //whole image.
+        if( renderRegion.active )
+        {
+            std::cout << "Region of Interest: " << data->width << " x " << data->height << " at (" << renderRegion.x
+                      << ", " << renderRegion.y << ") of " << renderRegion.frame.width << " x " << renderRegion.frame.height << std::endl;
+        }
+
+        //Report where every process was pinned.
+        if( bindings != NULL )
+        {
+            int procs;
+            MPI_Comm_size(MPI_COMM_WORLD, &procs);
+            for( int i = 0; i < procs; ++i )
+            {
+                std::cout << "Rank " << i << " binding: " << &bindings[i * bindingSize] << std::endl;
+            }
+            delete[] bindings;
+            bindings = NULL;
+        }
 
         //Start the main processing for the ray tracer.
-        masterMain( &data );
+        masterMain( data );
     }
     else
     {
-        slaveMain( &data );
+        slaveMain( data );
+        checkpointEnd(data);
+    }
+    return false;
+}
+
+//This function will write text to standard output in one write, so that
+//it is not mixed with what other processes write at the same time.
+//
+//Inputs:
+//    text - the text to write.
+//
+//Outputs: None
+static void writeAtOnce(const std::string& text)
+{
+    std::cout.flush();
+    size_t written = 0;
+    while( written < text.size() )
+    {
+        ssize_t count = write(STDOUT_FILENO, text.data() + written, text.size() - written);
+        if( count <= 0 )
+        {
+            break;
+        }
+        written += count;
+    }
+}
+
+//This function will render every job of the -batch file. The processes
+//are split into groups of -pack ranks, and group g takes jobs g, g + G,
+//g + 2G, ... of the G groups. With more than one group, the master of each
+//group buffers the summary of a job and prints it when the job is done.
+//
+//Inputs:
+//    launchArgs - the command line of the launch.
+//    rank - the rank of this process in MPI_COMM_WORLD.
+//    procs - the number of processes.
+//
+//Outputs: None
+static void runBatch(const std::vector<std::string>& launchArgs, int rank, int procs)
+{
+    std::vector< std::vector<std::string> > jobs;
+    if( readBatchJobs(runOptions.batchFile, &jobs) )
+    {
+        MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+
+    int packRanks = runOptions.packRanks > 0 ? std::min(runOptions.packRanks, procs) : procs;
+    int group = rank / packRanks;
+    int groups = (procs + packRanks - 1) / packRanks;
+    if( groups > 1 )
+    {
+        MPI_Comm_split(MPI_COMM_WORLD, group, rank, &renderComm);
+    }
+    int groupRank, groupProcs;
+    MPI_Comm_rank(renderComm, &groupRank);
+    MPI_Comm_size(renderComm, &groupProcs);
+
+    for( size_t j = group; j < jobs.size(); j += groups )
+    {
+        std::ostringstream line;
+        for( size_t k = 0; k < jobs[j].size(); ++k )
+        {
+            line << (k > 0 ? " " : "") << jobs[j][k];
+        }
+
+        std::ostringstream summary;
+        std::streambuf* console = NULL;
+        if( groups > 1 && groupRank == 0 )
+        {
+            console = std::cout.rdbuf(summary.rdbuf());
+        }
+
+        ConfigData data;
+        bool failed = loadBatchJob(launchArgs, jobs[j], &data) || threadsUnused();
+        std::ostringstream tag;
+        tag << "_job" << j + 1;
+        runOptions.fileTag = tag.str();
+
+        if( groupRank == 0 )
+        {
+            std::cout << std::endl << "Batch Job " << j + 1 << " of " << jobs.size() << " (ranks " << rank
+                      << " - " << rank + groupProcs - 1 << "): " << line.str() << std::endl;
+        }
+        if( !failed )
+        {
+            failed = renderJob(&data);
+        }
+        if( failed && groupRank == 0 )
+        {
+            std::cout << "Batch Job " << j + 1 << " FAILED and was skipped." << std::endl;
+        }
+        if( console != NULL )
+        {
+            std::cout.rdbuf(console);
+            writeAtOnce(summary.str());
+        }
+
+        //A slave that is done must not send the next job's results while
+        //the master still probes for this one's.
+        MPI_Barrier(renderComm);
+    }
+
+    if( groups > 1 )
+    {
+        MPI_Comm_free(&renderComm);
+        renderComm = MPI_COMM_WORLD;
+    }
+}
+
+int main( int argc, char* argv[] ) 
+{
+    //Keep the data that will be used for the scene.
+    MPI_Init(&argc, &argv);
+    ConfigData data;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &data.mpi_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &data.mpi_procs);
+
+    //The jobs of a batch are parsed on top of the whole command line.
+    std::vector<std::string> launchArgs(argv, argv + argc);
+    
+    //Pull out the options that the engine does not know about.
+    bool result = parseRunOptions(&argc, &argv, &runOptions);
+    if( result || threadsUnused() )
+    {
+        MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    bool batch = !runOptions.batchFile.empty();
+    std::string traceFile = runOptions.traceFile;
+
+    if( !batch )
+    {
+        //Try to initialize the scene.
+        result = initialize(&argc, &argv, &data);
+        //Make sure that the initialization was completed.	
+        if( result )
+        {
+            MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+        }
+
+        if( runOptions.hybrid )
+        {
+            data.partitioningMode = PART_MODE_HYBRID;
+        }
+
+        //-aa traces its sub-pixel rays in a second, larger copy of the scene.
+        if( runOptions.aaThreshold > 0.0f && antialiasLoad(argc, argv, &data, &antialiasFrame) )
+        {
+            MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+        }
+    }
+
+    if( !traceFile.empty() )
+    {
+        traceInit();
+    }
+
+    //Pin every process before anything big is allocated, so that its
+    //memory is first touched on its own NUMA node.
+    char binding[bindingSize] = "";
+    if( runOptions.bindMode != BIND_NONE )
+    {
+        MPI_Comm nodeComm;
+        int localRank;
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, data.mpi_rank, MPI_INFO_NULL, &nodeComm);
+        MPI_Comm_rank(nodeComm, &localRank);
+        MPI_Comm_free(&nodeComm);
+
+        std::string report;
+        bindProcess(runOptions.bindMode, localRank, &report);
+        strncpy(binding, report.c_str(), sizeof(binding) - 1);
+
+        if( data.mpi_rank == 0 )
+        {
+            bindings = new char[sizeof(binding) * data.mpi_procs];
+        }
+        MPI_Gather(binding, sizeof(binding), MPI_CHAR, bindings, sizeof(binding), MPI_CHAR, 0, MPI_COMM_WORLD);
+    }
+
+    //MPI Intialization
+    // MPI_Init(&argc, &argv);
+    // MPI_Comm_rank(MPI_COMM_WORLD, &data.mpi_rank);
+    // MPI_Comm_size(MPI_COMM_WORLD, &data.mpi_procs);
+
+    if( batch )
+    {
+        runBatch(launchArgs, data.mpi_rank, data.mpi_procs);
+    }
+    else if( renderJob(&data) )
+    {
+        MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
     }
 
     //Clean up the scene and other data.
     // Just addedd
+    double idleStart = traceNow();
     MPI_Barrier(MPI_COMM_WORLD);
+    traceEvent(TRACE_IDLE, idleStart, traceNow());
+    if( !traceFile.empty() )
+    {
+        bool written = traceWrite(&data, traceFile);
+        if( data.mpi_rank == 0 )
+        {
+            std::cout << "Trace: " << traceFile << (written ? "" : " FAILED") << std::endl;
+        }
+    }
     if (data.mpi_rank == 0) {
-        shutdown(&data);
+        if( batch )
+        {
+            releaseBatchScenes();
+        }
+        else
+        {
+            shutdown(&data);
+            if( runOptions.aaThreshold > 0.0f )
+            {
+                shutdown(&antialiasFrame);
+            }
+        }
     }
+
+    //The pooled buffers came from MPI and must go back before finalizing.
+    poolDrain();
+    MPI_Finalize();
     
 
     return 0;
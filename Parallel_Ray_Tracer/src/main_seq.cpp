@@ -10,9 +10,18 @@
 #include <string>
 #include <sys/stat.h>
 #include <errno.h>
+#include <chrono>
+#include <vector>
 using namespace std;
 
 #include "RayTrace.h"
+#include "options.h"
+#include "antialias.h"
+#include "costmap.h"
+#include "region.h"
+#include "perf_counters.h"
+#include "ray_stats.h"
+#include "tile_render.h"
 
 int main( int argc, char* argv[] ) 
 {
@@ -32,8 +41,15 @@ int main( int argc, char* argv[] )
         }
     }
     
+    //Pull out the options that the engine does not know about.
+    bool result = parseRunOptions(&argc, &argv, &runOptions);
+    if( result )
+    {
+        return 1;
+    }
+
     //Try to initialize the scene.
-    bool result = initialize(&argc, &argv, &data);
+    result = initialize(&argc, &argv, &data);
     //Make sure that the initialization was completed.	
     if( result )
     {
@@ -44,50 +60,143 @@ int main( int argc, char* argv[] )
     data.mpi_rank = 0;
     data.mpi_procs = 1;
 
+    //-aa traces its sub-pixel rays in a second, larger copy of the scene.
+    if( runOptions.aaThreshold > 0.0f && antialiasLoad(argc, argv, &data, &antialiasFrame) )
+    {
+        return 1;
+    }
+
     //Print a summary of the number of processes, width, height, and partitioning scheme.
     std::cout << "Scene: " << data.sceneID << std::endl;
     std::cout << "Width x Height: " << data.width << " x " << data.height << std::endl;
     std::cout << "Partitioning scheme: " << data.partitioningMode << std::endl;
     std::cout << "Number of Processes: " << 1 << std::endl;
 
+    //From here on, data describes only the region of interest, which is
+    //printed after the summary of the whole image.
+    if( regionInit(&data) )
+    {
+        return 1;
+    }
+    if( renderRegion.active )
+    {
+        std::cout << "Region of Interest: " << data.width << " x " << data.height << " at (" << renderRegion.x
+                  << ", " << renderRegion.y << ") of " << renderRegion.frame.width << " x " << renderRegion.frame.height << std::endl;
+    }
+    costMapInit(&data, runOptions.costCols, runOptions.costRows);
+
     //Allocate enough space.
     float* pixels = new float[ 3 * data.width * data.height ];
+    if( runOptions.perf )
+    {
+        perfInit();
+    }
+    if( runOptions.rayStats )
+    {
+        rayStatsInit();
+    }
     clock_t start = clock();
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+    perfPhase(PERF_SHADE);
 
-    //Render the scene.
-    for( int i = 0; i < data.height; ++i )
+    if( runOptions.renderThreads > 0 )
     {
-        for( int j = 0; j < data.width; ++j )
-        {
-            int row = i;
-            int column = j;
-
-            //Calculate the index into the array.
-            int baseIndex = 3 * ( row * data.width + column );
-
-            //Call the function to shade the pixel.
-            shadePixel(&(pixels[baseIndex]),row,j,&data);
-        }
+        //Render the scene in tiles over several threads.
+        renderTiles(pixels, &data, runOptions.renderThreads);
+    }
+    else
+    {
+        //Render the scene.
+        renderImage(pixels, &data);
     }
 
     //Stop the timing.
+    perfPhase(PERF_OFF);
     clock_t stop = clock();
+    std::chrono::duration<float> wallTime = std::chrono::steady_clock::now() - wallStart;
 
-    //Figure out how much time was taken.
+    //Figure out how much time was taken. clock() adds up the time of every
+    //thread, so with -t the wall clock is reported instead.
     float time = (float)(stop - start) / (float)CLOCKS_PER_SEC;
+    if( runOptions.renderThreads > 0 )
+    {
+        time = wallTime.count();
+    }
     std::cout << "Execution Time: " << time << " seconds" << std::endl << std::endl;
+    if( runOptions.renderThreads > 0 )
+    {
+        std::cout << "Render Threads: " << runOptions.renderThreads << std::endl;
+        std::cout << "Throughput: " << (double)data.width * data.height / wallTime.count() << " pixels/second" << std::endl;
+    }
+    if( runOptions.aaThreshold > 0.0f )
+    {
+        printAntialiasStats(&antialiasStats);
+    }
+    if( runOptions.perf )
+    {
+        printPerfStats(&perfStats, (long long)data.width * data.height, 1);
+    }
+    if( runOptions.rayStats )
+    {
+        rayStatsCollect();
+        printRayStats(&rayStats, (long long)data.width * data.height);
+    }
+
+    //Make sure that the threads did not get in each other's way.
+    long long threadDiffs = 0;
+    if( runOptions.threadChecks > 0 )
+    {
+        threadDiffs = checkTiles(pixels, &data, runOptions.renderThreads, runOptions.threadChecks);
+        std::cout << "Thread Check: " << threadDiffs << " pixels differ from the plain loop over "
+                  << runOptions.threadChecks << " renders" << (threadDiffs > 0 ? " FAILED" : "") << std::endl;
+    }
 
     //Now save the image.
     std::cout << "Image will be save to: ";
     std::string file = "renders/" + generateFileName();
     std::cout << file << std::endl;
-    savePixels(file, pixels, &data);
+    //The writer is threaded, so this is timed by the wall clock.
+    std::chrono::steady_clock::time_point saveStart = std::chrono::steady_clock::now();
+    //With -roi-over, the full frame is saved with the region pasted in.
+    ConfigData* saved = &data;
+    float* image = pixels;
+    std::vector<float> composite;
+    if( !runOptions.roiBase.empty() )
+    {
+        composite.resize(3 * (size_t)renderRegion.frame.width * renderRegion.frame.height);
+        if( regionComposite(runOptions.roiBase, pixels, &data, &composite[0]) )
+        {
+            saved = &renderRegion.frame;
+            image = &composite[0];
+        }
+        else
+        {
+            std::cout << "Saving the region on its own instead." << std::endl;
+        }
+    }
+    regionSavePng(file, image, saved);
+    std::chrono::duration<float> saveTime = std::chrono::steady_clock::now() - saveStart;
+    std::cout << "Save Time: " << saveTime.count() << " seconds" << std::endl;
+
+    //Save the cost grid next to the image, as a picture and for analysis.
+    if( !costMap.cost.empty() )
+    {
+        std::string base = file.substr(0, file.find_last_of('.'));
+        bool saved = costMapWrite(base + ".cost", &costMap);
+        saved = costMapWriteHeatmap(base + "_cost.png", &costMap) && saved;
+        std::cout << "Cost map (" << costMap.cols << " x " << costMap.rows << "): " << base << ".cost";
+        std::cout << (saved ? "" : " FAILED") << std::endl;
+    }
     
     //Clean up the scene and other data.
     shutdown(&data);
+    if( runOptions.aaThreshold > 0.0f )
+    {
+        shutdown(&antialiasFrame);
+    }
 
     //Delete the pixels.
     delete[] pixels;
 
-    return 0;
+    return threadDiffs > 0 ? 2 : 0;
 }
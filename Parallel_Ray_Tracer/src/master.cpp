@@ -3,23 +3,67 @@
 #include <iostream>
 #include <mpi.h>
 #include <math.h>
+#include <new>
 #include <queue>
-#include <map>
+#include <vector>
 #include "RayTrace.h"
 
 #include "master.h"
+#include "options.h"
+#include "mpi_output.h"
+#include "partition.h"
+#include "buffer_pool.h"
+#include "costmap.h"
+#include "trace.h"
+#include "antialias.h"
+#include "region.h"
+#include "bands.h"
+#include "perf_counters.h"
+#include "ray_stats.h"
+#include "tile_codec.h"
+#include "affinity.h"
+#include "batch.h"
+#include "live_stream.h"
+#include "unit_order.h"
+#include "incremental.h"
+#include "checkpoint.h"
 
 void masterMain(ConfigData* data)
 {
-    //Allocate space for the image on the master.
-    float* pixels = new float[3 * data->width * data->height];
+    //Allocate space for the image on the master, on its own NUMA node
+    //when it is pinned with -bind.
+    size_t pixelBytes = sizeof(float) * 3 * data->width * data->height;
+    bool local = runOptions.bindMode != BIND_NONE;
+    float* pixels;
+    if (local) {
+        pixels = (float*)allocateLocal(pixelBytes);
+    }
+    else {
+        pixels = new (std::nothrow) float[3 * data->width * data->height];
+    }
+    if (pixels == NULL) {
+        std::cerr << "ERROR: could not allocate the " << pixelBytes << " bytes of the image" << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, MPI_ERR_NO_MEM);
+    }
+
+    //Count the finished tiles so that they can be saved before the end.
+    checkpointStart(pixels, !writesOwnRegion(data));
     
     //Execution time will be defined as how long it takes
     //for the given function to execute based on partitioning
     //type.
     double renderTime = 0.0, startTime, stopTime;
 
-    switch (data->partitioningMode)
+    //Stream the tiles to a viewer as they are finished.
+    if (!runOptions.liveSocket.empty()) {
+        liveOpen(runOptions.liveSocket, data);
+    }
+
+    //Everything the partitioning functions do between tiles counts as
+    //communication.
+    perfPhase(PERF_COMM);
+    //PART_MODE_HYBRID is not one of the engine's PartType values.
+    switch ((int)data->partitioningMode)
     
     {
         case PART_MODE_NONE:
@@ -45,7 +89,7 @@ void masterMain(ConfigData* data)
         // Juliana
         case PART_MODE_STATIC_CYCLES_HORIZONTAL:
             startTime = MPI_Wtime();
-            masterStaticCyclesHorizontal();
+            masterStaticCyclesHorizontal(data, pixels);
             stopTime = MPI_Wtime();
             break;
 
@@ -56,52 +100,194 @@ void masterMain(ConfigData* data)
             stopTime = MPI_Wtime();
             break;    
 
+        case PART_MODE_HYBRID:
+            startTime = MPI_Wtime();
+            hybridMaster(data, pixels);
+            stopTime = MPI_Wtime();
+            break;
+
         default:
             std::cout << "This mode (" << data->partitioningMode;
             std::cout << ") is not currently implemented." << std::endl;
             break;
     }
 
+    perfPhase(PERF_OFF);
+    liveClose();
     renderTime = stopTime - startTime;
     std::cout << "Execution Time: " << renderTime << " seconds" << std::endl << std::endl;
 
+    //Gather the shading costs of every process.
+    if (!costMap.cost.empty()) {
+        MPI_Reduce(MPI_IN_PLACE, &costMap.cost[0], costMap.cost.size(), MPI_DOUBLE, MPI_SUM, 0, renderComm);
+    }
+
+    //Report how much of the image needed anti-aliasing.
+    if (runOptions.aaThreshold > 0.0f) {
+        MPI_Reduce(MPI_IN_PLACE, &antialiasStats, 3, MPI_LONG_LONG, MPI_SUM, 0, renderComm);
+        printAntialiasStats(&antialiasStats);
+    }
+
+    //Report the hardware counters of every process.
+    if (runOptions.perf) {
+        MPI_Reduce(MPI_IN_PLACE, &perfStats, sizeof(perfStats) / sizeof(long long), MPI_LONG_LONG, MPI_SUM, 0, renderComm);
+        printPerfStats(&perfStats, (long long)data->width * data->height, data->mpi_procs);
+    }
+
+    //And what the engine did for it.
+    if (runOptions.rayStats) {
+        rayStatsCollect();
+        MPI_Reduce(MPI_IN_PLACE, &rayStats, sizeof(rayStats) / sizeof(long long), MPI_LONG_LONG, MPI_SUM, 0, renderComm);
+        printRayStats(&rayStats, (long long)data->width * data->height);
+    }
+
+    //And whether compressing the results paid off.
+    if (runOptions.compress) {
+        MPI_Reduce(MPI_IN_PLACE, &codecStats, 4, MPI_LONG_LONG, MPI_SUM, 0, renderComm);
+        printCodecStats(&codecStats);
+    }
+
+    //And how much of the image made it to the viewer.
+    if (!runOptions.liveSocket.empty()) {
+        printLiveStats(&liveStats);
+    }
+
     //After this gets done, save the image.
     std::cout << "Image will be save to: ";
-    std::string file = "renders/" + generateFileName();
+    std::string file = renderFileName();
+    if (runOptions.outputFormat != OUTPUT_PNG) {
+        file = runOptions.outputFile;
+    }
     std::cout << file << std::endl;
-    savePixels(file, pixels, data);
+    //The PNG writer is threaded; let the threads use the whole node.
+    if (runOptions.bindMode != BIND_NONE) {
+        widenToNode();
+    }
+    double saveStart = MPI_Wtime();
+
+    //With -roi-over, the full frame is saved with the region pasted in.
+    ConfigData* saved = data;
+    float* image = pixels;
+    std::vector<float> composite;
+    if (!runOptions.roiBase.empty()) {
+        composite.resize(3 * (size_t)renderRegion.frame.width * renderRegion.frame.height);
+        if (regionComposite(runOptions.roiBase, pixels, data, &composite[0])) {
+            saved = &renderRegion.frame;
+            image = &composite[0];
+        }
+        else {
+            std::cout << "Saving the region on its own instead." << std::endl;
+        }
+    }
+
+    if (runOptions.outputFormat == OUTPUT_PNG) {
+        regionSavePng(file, image, saved);
+    }
+    else if (!writesOwnRegion(data)) {
+        //Only the master has the image, so it writes the whole file.
+        writeRowsCollective(MPI_COMM_SELF, file, saved, runOptions.outputFormat,
+                            rowRange(0, saved->height - 1), 0, saved->width, image, 3 * saved->width);
+    }
+    double saveStop = MPI_Wtime();
+    traceEvent(TRACE_SAVE, saveStart, saveStop);
+    std::cout << "Save Time: " << saveStop - saveStart << " seconds" << std::endl;
+
+    //Save the cost grid next to the image, as a picture and for analysis.
+    if (!costMap.cost.empty()) {
+        std::string base = file.substr(0, file.find_last_of('.'));
+        bool saved = costMapWrite(base + ".cost", &costMap);
+        saved = costMapWriteHeatmap(base + "_cost.png", &costMap) && saved;
+        std::cout << "Cost map (" << costMap.cols << " x " << costMap.rows << "): " << base << ".cost";
+        std::cout << (saved ? "" : " FAILED") << std::endl;
+    }
+
+    //The image is saved, so there is nothing left to checkpoint.
+    checkpointEnd(data);
 
     //Delete the pixel data.
-    delete[] pixels; 
+    if (local) {
+        freeLocal(pixels, pixelBytes);
+    }
+    else {
+        delete[] pixels;
+    }
+}
+
+// the units still to hand out: every index of the grid in turn, or the
+// indices that are left after the units were filtered or reordered
+struct UnitSource {
+    UnitGrid grid;
+    bool listed;
+    std::vector<int> order;
+    int next;
+};
+
+// set up the units of the columns from firstCol. Only -incremental, -resume
+// and -lpt need a list of indices; otherwise nothing is stored per unit.
+static void unitSourceInit(ConfigData* data, float* pixels, int firstCol, bool incremental, UnitSource* source){
+    source->grid = unitGrid(data, firstCol);
+    source->next = 0;
+    source->listed = incremental || checkpoint.resumed || !runOptions.lptSource.empty();
+    if (!source->listed) {
+        return;
+    }
+
+    std::queue<WorkUnit> queue;
+    createDynamicUnits(data, firstCol, &queue);
+    if (incremental) {
+        incrementalFilter(data, pixels, &queue);
+    }
+    checkpointFilter(data, &queue);
+    if (!runOptions.lptSource.empty()) {
+        orderUnitsByCost(data, runOptions.lptSource, &queue);
+    }
+
+    source->order.reserve(queue.size());
+    while (!queue.empty()) {
+        source->order.push_back(queue.front().id);
+        queue.pop();
+    }
+}
+
+static bool unitsLeft(const UnitSource* source){
+    int count = source->listed ? (int)source->order.size() : source->grid.count;
+    return source->next < count;
+}
+
+static int takeUnit(UnitSource* source){
+    int position = source->next++;
+    return source->listed ? source->order[position] : position;
 }
 
 void dynamicMaster(ConfigData* data, float* pixels){
 
     // centralized single queue to split between slave processes (worker does no computations)
    // int numWorkers = data->mpi_procs -1;
-    int blockWidth = data->dynamicBlockWidth;
-    int blockHeight = data->dynamicBlockHeight;
-    int imageWidth = data->width;
-    int imageHeight = data->height;
     double communicationTime = 0.0;
     double computationTime = 0.0;
 
-    // Centralized QUEUE
-    std::queue<DynamicUnit> centralizeQueue;
-    std::map<int, DynamicUnit> workInProgress;
+    // Centralized QUEUE, as unit indices; the unit each worker has, or -1
+    UnitSource source;
+    std::vector<int> workInProgress(data->mpi_procs, -1);
+
+    // speculative copies of straggling units once the queue is empty
+    std::vector<char> completedUnits;
+    std::vector<char> speculatedUnits;
+    std::vector<char> speculativeCopy(data->mpi_procs, 0);
+    std::vector<int> cancelledWork(data->mpi_procs, -1);
+    std::vector<int> sentAt(data->mpi_procs, 0);
+    int unitsSent = 0;
+    int speculativeCopies = 0;
+    int speculativeHits = 0;
+    int wastedUnits = 0;
 
     // create work units for worker processes
-    for (int row = 0; row < imageHeight; row+=blockHeight){
-        for(int col = 0; col < imageWidth; col+=blockWidth){
-            DynamicUnit dynamicUnit;
-            dynamicUnit.startRow = row;
-            dynamicUnit.startCol = col;
-            // overflow check
-            dynamicUnit.blockHeight = std::min(blockHeight, imageHeight  - row);  
-            dynamicUnit.blockWidth = std::min(blockWidth, imageWidth   - col);
-            centralizeQueue.push(dynamicUnit);
+    unitSourceInit(data, pixels, 0, incrementalRender.active, &source);
 
-        }
+    // only copies can finish a unit twice
+    if (runOptions.speculate) {
+        completedUnits.assign(source.grid.count, 0);
+        speculatedUnits.assign(source.grid.count, 0);
     }
 
     // variable to determine if all workers are complete & queue empty
@@ -112,55 +298,111 @@ void dynamicMaster(ConfigData* data, float* pixels){
     // termination case
     while (completedWorkers < data->mpi_procs - 1){
         double commStart = MPI_Wtime();
-        MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+        MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, renderComm, &status);
         double commEnd = MPI_Wtime();
         communicationTime += (commEnd - commStart);
+        traceEvent(TRACE_PROBE, commStart, commEnd, status.MPI_SOURCE);
 
         int rank = status.MPI_SOURCE;
         int tag = status.MPI_TAG;
     
         if(tag == 1) {
             double commStart2 = MPI_Wtime();
-            MPI_Recv(NULL, 0, MPI_CHAR, rank, tag, MPI_COMM_WORLD, &status);
+            MPI_Recv(NULL, 0, MPI_CHAR, rank, tag, renderComm, &status);
             double commEnd2 = MPI_Wtime();
             communicationTime += (commEnd2 - commStart2);
+            traceEvent(TRACE_RECV, commStart2, commEnd2, rank);
 
-            if(!centralizeQueue.empty()) {
-                DynamicUnit unit = centralizeQueue.front();
-                centralizeQueue.pop();
+            // the worker gave up on a unit that was finished somewhere else
+            if (cancelledWork[rank] >= 0) {
+                cancelledWork[rank] = -1;
+                wastedUnits++;
+            }
 
-                int msg[4] = {unit.startRow, unit.startCol, unit.blockWidth, unit.blockHeight};
-                
-                double commStart3 = MPI_Wtime();
-                MPI_Send(msg, 4, MPI_INT, rank, 2, MPI_COMM_WORLD);
-                double commEnd3 = MPI_Wtime();
-                communicationTime += (commEnd3 - commStart3);
+            // once the queue is empty, idle workers get a copy of the unit
+            // that was sent out the longest ago and is still out. The index
+            // says nothing about that once -lpt or a filter changed the order.
+            int copyOf = -1;
+            if (!unitsLeft(&source) && runOptions.speculate) {
+                for (int worker = 1; worker < data->mpi_procs; ++worker) {
+                    int id = workInProgress[worker];
+                    if (id >= 0 && !completedUnits[id] && !speculatedUnits[id] && (copyOf < 0 || sentAt[worker] < sentAt[copyOf])) {
+                        copyOf = worker;
+                    }
+                }
+            }
 
-                workInProgress[rank] = unit;
+            // the message is just the unit index; -1 means there is no more work
+            int unit = -1;
+            if (unitsLeft(&source)) {
+                unit = takeUnit(&source);
+                speculativeCopy[rank] = 0;
+            }
+            else if (copyOf >= 0) {
+                unit = workInProgress[copyOf];
+                speculatedUnits[unit] = 1;
+                speculativeCopy[rank] = 1;
+                speculativeCopies++;
             }
-            else {
-                int done[4] = {0, 0, 0, 0};
 
-                double commStart4 = MPI_Wtime();
-                MPI_Send(done, 4, MPI_INT, rank, 2, MPI_COMM_WORLD);
-                double commEnd4 = MPI_Wtime();
-                communicationTime += (commEnd4 - commStart4);
+            double commStart3 = MPI_Wtime();
+            MPI_Send(&unit, 1, MPI_INT, rank, 2, renderComm);
+            double commEnd3 = MPI_Wtime();
+            communicationTime += (commEnd3 - commStart3);
+            traceEvent(TRACE_SEND, commStart3, commEnd3, rank);
 
+            if (unit >= 0) {
+                workInProgress[rank] = unit;
+                sentAt[rank] = unitsSent++;
+            }
+            else {
                 completedWorkers ++; 
             }
         }
         else if(tag == 3) {
-            DynamicUnit unit = workInProgress[rank];
+            // a result can still arrive for a unit that was cancelled after it was sent
+            bool cancelled = workInProgress[rank] < 0;
+            WorkUnit unit = unitAt(&source.grid, cancelled ? cancelledWork[rank] : workInProgress[rank]);
             int size = (unit.blockWidth * unit.blockHeight * 3) + 1;
-            float* tempBuffer = new float[size];
+            float* tempBuffer = poolAcquire(size);
 
             double commStart5 = MPI_Wtime();
-            MPI_Recv(tempBuffer, size, MPI_FLOAT, rank, 3, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            recvTile(tempBuffer, size, rank, 3);
             double commEnd5 = MPI_Wtime();
             communicationTime += (commEnd5 - commStart5);
+            traceEvent(TRACE_RECV, commStart5, commEnd5, rank);
             float computeTime = tempBuffer[size - 1];
 
             computationTime += computeTime;
+            workInProgress[rank] = -1;
+
+            if (runOptions.speculate) {
+                // the other copy got here first
+                if (completedUnits[unit.id]) {
+                    wastedUnits++;
+                    poolRelease(tempBuffer);
+                    cancelledWork[rank] = -1;
+                    continue;
+                }
+                completedUnits[unit.id] = 1;
+                if (speculativeCopy[rank]) {
+                    speculativeHits++;
+                }
+
+                // tell anyone else working on this unit to stop
+                for (int worker = 1; worker < data->mpi_procs; ++worker) {
+                    if (workInProgress[worker] == unit.id) {
+                        double commStart6 = MPI_Wtime();
+                        MPI_Send(&unit.id, 1, MPI_INT, worker, 4, renderComm);
+                        double commEnd6 = MPI_Wtime();
+                        communicationTime += (commEnd6 - commStart6);
+                        traceEvent(TRACE_SEND, commStart6, commEnd6, worker);
+
+                        cancelledWork[worker] = unit.id;
+                        workInProgress[worker] = -1;
+                    }
+                }
+            }
            
             for (int i = 0; i < unit.blockHeight; ++i) {
                 for (int j = 0; j < unit.blockWidth; ++j) {
@@ -171,9 +413,11 @@ void dynamicMaster(ConfigData* data, float* pixels){
                     pixels[masterIndex + 2] = tempBuffer[bufferIndex + 2];
                 }
             }
+            liveTile(pixels + 3 * (unit.startRow * data->width + unit.startCol), 3 * data->width,
+                     unit.startRow, unit.startCol, unit.blockHeight, unit.blockWidth);
+            checkpointTile(unit.startRow, unit.startCol, unit.blockHeight, unit.blockWidth);
     
-            delete[] tempBuffer;
-            workInProgress.erase(rank);
+            poolRelease(tempBuffer);
 
         }
     }
@@ -183,68 +427,259 @@ void dynamicMaster(ConfigData* data, float* pixels){
     std::cout << "Total Communication Time: " << communicationTime << " seconds" << std::endl;
     double c2cRatio = communicationTime / computationTime;
     std::cout << "C-to-C Ratio: " << c2cRatio << std::endl;
+
+    if (runOptions.speculate) {
+        std::cout << "Speculative Copies: " << speculativeCopies << std::endl;
+        std::cout << "Speculative Hits: " << speculativeHits << std::endl;
+        std::cout << "Wasted Units: " << wastedUnits << std::endl;
+    }
     
 }
 
 
 
-void staticStripsVerticalMaster(ConfigData* data, float* pixels){
-    //Start the computation time timer.
-    double computationTime = 0.0;
-    double communicationTime = 0.0;
+// state shared by the hybrid master loop and its message handler
+struct HybridState {
+    UnitSource pool;
+    std::vector<int> workInProgress;
+    int completedWorkers;
+    double computationTime;
+    double communicationTime;
+};
 
-    int cols = data->width / data->mpi_procs;  // divide height into strips
-    int extra = data->width % data->mpi_procs; // extra rows for some processes
-    int firstCol = data->mpi_rank * cols;
-    int lastCol = firstCol  + cols - 1;
+// handle one message from a worker: a finished strip, a request for work,
+// or a finished unit. Returns false if block is false and nothing is waiting.
+static bool hybridHandleMessage(ConfigData* data, float* pixels, HybridState* state, bool block){
+    MPI_Status status;
+    int flag = 1;
 
-    if (data->mpi_rank == data->mpi_procs - 1) {
-        lastCol += extra;
+    double commStart = MPI_Wtime();
+    if (block) {
+        MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, renderComm, &status);
+    }
+    else {
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, renderComm, &flag, &status);
+    }
+    double commEnd = MPI_Wtime();
+    state->communicationTime += (commEnd - commStart);
+    if (!flag) {
+        return false;
     }
+    traceEvent(TRACE_PROBE, commStart, commEnd, status.MPI_SOURCE);
 
-    double computeStart = MPI_Wtime();
+    int rank = status.MPI_SOURCE;
+    int tag = status.MPI_TAG;
+
+    if (tag == 100) {
+        // the static strip of this worker
+        int firstCol, lastCol;
+        hybridStripColumns(data, rank, &firstCol, &lastCol);
+        int numCols = lastCol - firstCol + 1;
+        int size = 3 * data->height * numCols + 1;
+        float* tempBuffer = poolAcquire(size);
+
+        double commStart1 = MPI_Wtime();
+        recvTile(tempBuffer, size, rank, 100);
+        double commEnd1 = MPI_Wtime();
+        state->communicationTime += (commEnd1 - commStart1);
+        traceEvent(TRACE_RECV, commStart1, commEnd1, rank);
+        state->computationTime += tempBuffer[size - 1];
+
+        for (int j = 0; j < numCols; ++j) {
+            for (int k = 0; k < data->height; ++k) {
+                int masterIndex = 3 * (k * data->width + (firstCol + j));
+                int slaveIndex = 3 * (k * numCols + j);
+                pixels[masterIndex] = tempBuffer[slaveIndex];
+                pixels[masterIndex + 1] = tempBuffer[slaveIndex + 1];
+                pixels[masterIndex + 2] = tempBuffer[slaveIndex + 2];
+            }
+        }
+        liveTile(pixels + 3 * firstCol, 3 * data->width, 0, firstCol, data->height, numCols);
+        checkpointTile(0, firstCol, data->height, numCols);
+        poolRelease(tempBuffer);
+    }
+    else if (tag == 1) {
+        double commStart2 = MPI_Wtime();
+        MPI_Recv(NULL, 0, MPI_CHAR, rank, tag, renderComm, MPI_STATUS_IGNORE);
+
+        // same messages as the dynamic mode; -1 means there is no more work
+        int unit = -1;
+        if (unitsLeft(&state->pool)) {
+            unit = takeUnit(&state->pool);
+            state->workInProgress[rank] = unit;
+        }
+        else {
+            state->completedWorkers++;
+        }
+        MPI_Send(&unit, 1, MPI_INT, rank, 2, renderComm);
+        double commEnd2 = MPI_Wtime();
+        state->communicationTime += (commEnd2 - commStart2);
+        traceEvent(TRACE_RECV, commStart2, commEnd2, rank);
+    }
+    else if (tag == 3) {
+        WorkUnit unit = unitAt(&state->pool.grid, state->workInProgress[rank]);
+        int size = (unit.blockWidth * unit.blockHeight * 3) + 1;
+        float* tempBuffer = poolAcquire(size);
+
+        double commStart3 = MPI_Wtime();
+        recvTile(tempBuffer, size, rank, 3);
+        double commEnd3 = MPI_Wtime();
+        state->communicationTime += (commEnd3 - commStart3);
+        traceEvent(TRACE_RECV, commStart3, commEnd3, rank);
+        state->computationTime += tempBuffer[size - 1];
+
+        for (int i = 0; i < unit.blockHeight; ++i) {
+            for (int j = 0; j < unit.blockWidth; ++j) {
+                int masterIndex = 3 * ((unit.startRow + i) * data->width + (unit.startCol + j));
+                int bufferIndex = 3 * (i * unit.blockWidth + j);
+                pixels[masterIndex] = tempBuffer[bufferIndex];
+                pixels[masterIndex + 1] = tempBuffer[bufferIndex + 1];
+                pixels[masterIndex + 2] = tempBuffer[bufferIndex + 2];
+            }
+        }
+        liveTile(pixels + 3 * (unit.startRow * data->width + unit.startCol), 3 * data->width,
+                 unit.startRow, unit.startCol, unit.blockHeight, unit.blockWidth);
+        checkpointTile(unit.startRow, unit.startCol, unit.blockHeight, unit.blockWidth);
+        poolRelease(tempBuffer);
+        state->workInProgress[rank] = -1;
+    }
+    return true;
+}
+
+void hybridMaster(ConfigData* data, float* pixels){
+    HybridState state;
+    state.completedWorkers = 0;
+    state.computationTime = 0.0;
+    state.communicationTime = 0.0;
+
+    // the left part of the image is split into strips, the rest goes into a pool
+    int firstCol, lastCol;
+    int staticCols = hybridStripColumns(data, data->mpi_rank, &firstCol, &lastCol);
+    unitSourceInit(data, pixels, staticCols, false, &state.pool);
+    state.workInProgress.assign(data->mpi_procs, -1);
+
+    // render the master's strip, answering workers between rows so that
+    // the ones that finish early are not left waiting
     for (int i = 0; i < data->height; ++i) {
+        double computeStart = MPI_Wtime();
+        perfPhase(PERF_SHADE);
         for (int j = firstCol; j <= lastCol; ++j) {
             int baseIndex = 3 * (i * data->width + j);
-            shadePixel(&(pixels[baseIndex]), i, j, data);
+            shadePixelCosted(&(pixels[baseIndex]), i, j, data);
+        }
+        double computeEnd = MPI_Wtime();
+        perfPhase(PERF_COMM);
+        state.computationTime += (computeEnd - computeStart);
+        traceEvent(TRACE_SHADE, computeStart, computeEnd);
+
+        while (hybridHandleMessage(data, pixels, &state, false)) {
         }
     }
-    double computeEnd = MPI_Wtime();
-    double totalMasterTime = computeEnd - computeStart;
-    computationTime += totalMasterTime;
+    double aaStart = MPI_Wtime();
+    perfPhase(PERF_SHADE);
+    antialiasTile(pixels + 3 * firstCol, 3 * data->width, 0, firstCol, data->height, lastCol - firstCol + 1, data);
+    state.computationTime += MPI_Wtime() - aaStart;
+    perfPhase(PERF_COMM);
+    liveTile(pixels + 3 * firstCol, 3 * data->width, 0, firstCol, data->height, lastCol - firstCol + 1);
+    checkpointTile(0, firstCol, data->height, lastCol - firstCol + 1);
+
+    // then serve the pool, taking units for the master whenever no one is waiting
+    while (state.completedWorkers < data->mpi_procs - 1 || unitsLeft(&state.pool)) {
+        if (hybridHandleMessage(data, pixels, &state, false)) {
+            continue;
+        }
 
-    // receive rendered scenes
-    for( int i = 1; i < data->mpi_procs; ++i )
-    {
-        int columnOne = i * cols;
-        int columnFinish = columnOne + cols - 1;
+        if (unitsLeft(&state.pool)) {
+            WorkUnit unit = unitAt(&state.pool.grid, takeUnit(&state.pool));
 
-        if (i == data->mpi_procs - 1) {
-            columnFinish += extra;
+            double computeStart = MPI_Wtime();
+            perfPhase(PERF_SHADE);
+            for (int i = 0; i < unit.blockHeight; ++i) {
+                for (int j = 0; j < unit.blockWidth; ++j) {
+                    int row = unit.startRow + i;
+                    int col = unit.startCol + j;
+                    shadePixelCosted(&(pixels[3 * (row * data->width + col)]), row, col, data);
+                }
+            }
+            antialiasTile(pixels + 3 * (unit.startRow * data->width + unit.startCol), 3 * data->width,
+                          unit.startRow, unit.startCol, unit.blockHeight, unit.blockWidth, data);
+            double computeEnd = MPI_Wtime();
+            perfPhase(PERF_COMM);
+            state.computationTime += (computeEnd - computeStart);
+            traceEvent(TRACE_SHADE, computeStart, computeEnd);
+            liveTile(pixels + 3 * (unit.startRow * data->width + unit.startCol), 3 * data->width,
+                     unit.startRow, unit.startCol, unit.blockHeight, unit.blockWidth);
+            checkpointTile(unit.startRow, unit.startCol, unit.blockHeight, unit.blockWidth);
+            continue;
         }
 
-        float* tempBuffer = new float[3 * data->height * (columnFinish - columnOne + 1)];
+        hybridHandleMessage(data, pixels, &state, true);
+    }
 
-        // Receive the data into tempBuffer
-        double commStart1 = MPI_Wtime();
-        MPI_Recv(tempBuffer, (3 * data->height * (columnFinish - columnOne + 1)) +1, MPI_FLOAT, i, 100, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        double commEnd1 = MPI_Wtime();
-        communicationTime += (commEnd1 - commStart1);
+    //Print the times and the c-to-c ratio
+	//This section of printing, IN THIS ORDER, needs to be included in all of the
+	//functions that you write at the end of the function.
+    std::cout << "Total Computation Time: " << state.computationTime << " seconds" << std::endl;
+    std::cout << "Total Communication Time: " << state.communicationTime << " seconds" << std::endl;
+    double c2cRatio = state.communicationTime / state.computationTime;
+    std::cout << "C-to-C Ratio: " << c2cRatio << std::endl;
+}
 
-        float computeTime = tempBuffer[3 * data->height * (columnFinish - columnOne + 1)];
-        computationTime += computeTime;
+void staticStripsVerticalMaster(ConfigData* data, float* pixels){
+    //Start the computation time timer.
+    double computationTime = 0.0;
+    double communicationTime = 0.0;
 
-        int receivedCols = columnFinish - columnOne + 1;
-        for (int j = 0; j < receivedCols; ++j) {
-            for (int k = 0; k < data->height; ++k) {
-                int masterIndex = 3 * (k * data->width + (columnOne + j));
-                int slaveIndex = 3 * (k * receivedCols + j);
-                pixels[masterIndex] = tempBuffer[slaveIndex];
-                pixels[masterIndex + 1] = tempBuffer[slaveIndex + 1];
-                pixels[masterIndex + 2] = tempBuffer[slaveIndex + 2];
-            }
+    // the strips are equal, or sized by speed with -weighted
+    int firstCol, lastCol;
+    stripColumns(data, data->mpi_rank, &firstCol, &lastCol);
+
+    // post the receives for every band of every strip before rendering,
+    // so that the bands come in while the master works on its own strip
+    BandReceiver receiver;
+    if (!writesOwnRegion(data)) {
+        receiver.regions.resize(data->mpi_procs);
+        for (int i = 1; i < data->mpi_procs; ++i) {
+            StaticRegion* region = &receiver.regions[i];
+            int nFirstCol, nLastCol;
+            stripColumns(data, i, &nFirstCol, &nLastCol);
+            region->rows = rowRange(0, data->height - 1);
+            region->firstCol = nFirstCol;
+            region->numCols = nLastCol - nFirstCol + 1;
         }
-        delete[] tempBuffer;
+        double commStart = MPI_Wtime();
+        postBandReceives(data, &receiver);
+        communicationTime += MPI_Wtime() - commStart;
+    }
+
+    double computeStart = MPI_Wtime();
+    perfPhase(PERF_SHADE);
+    for (int i = 0; i < data->height; ++i) {
+        for (int j = firstCol; j <= lastCol; ++j) {
+            int baseIndex = 3 * (i * data->width + j);
+            shadePixelCosted(&(pixels[baseIndex]), i, j, data);
+        }
+    }
+    antialiasTile(pixels + 3 * firstCol, 3 * data->width, 0, firstCol, data->height, lastCol - firstCol + 1, data);
+    double computeEnd = MPI_Wtime();
+    perfPhase(PERF_COMM);
+    double totalMasterTime = computeEnd - computeStart;
+    traceEvent(TRACE_SHADE, computeStart, computeEnd);
+    computationTime += totalMasterTime;
+    liveTile(pixels + 3 * firstCol, 3 * data->width, 0, firstCol, data->height, lastCol - firstCol + 1);
+    checkpointTile(0, firstCol, data->height, lastCol - firstCol + 1);
+
+    if (writesOwnRegion(data)) {
+        //Every process writes its own strip, so only the times are collected.
+        double commStart = MPI_Wtime();
+        computationTime = writeOwnRegion(data, rowRange(0, data->height - 1), firstCol, lastCol - firstCol + 1,
+                                         pixels + 3 * firstCol, 3 * data->width, computationTime);
+        double commEnd = MPI_Wtime();
+        communicationTime += (commEnd - commStart);
+    }
+    else {
+        // assemble the strips band by band as they arrive
+        computationTime += finishBandReceives(data, &receiver, pixels, &communicationTime);
     }
         
      
@@ -264,52 +699,32 @@ void staticSquareBlocksMaster(ConfigData* data, float* pixels){
 	double compTime = 0.0;
 	double commTime = 0.0;
 
-// dividing into square blocks
-    int square = 0;
-    int root = (int) sqrt(data->mpi_procs);
-    float test = (float)data->mpi_procs / (float)root;
-    if(test != root){
-        square = ((int)sqrt(data->mpi_procs) + 1) * ((int)sqrt(data->mpi_procs) + 1);
-    }else{
-        square = data->mpi_procs;
-    }
-
-    int size = (data->width)*(data->height) / square;  // divide total number of elements into sqaures
-    int dim = sqrt(size);
+    // dividing into square blocks, or blocks sized by speed with -weighted
+    int firstRow, lastRow, firstCol, lastCol;
+    blockBounds(data, data->mpi_rank, &firstRow, &lastRow, &firstCol, &lastCol);
 
-    int max = data->width / dim;
-    int hOffset = (data->width - (dim * max));
-    if(hOffset > 1){
-        hOffset /= 2;
-    }
-    int vOffset = (data->height - (dim * max));
-    if(vOffset > 1){
-        vOffset /= 2;
-    }
-
-    int firstCol = (data->mpi_rank % max) * dim + hOffset;
-    int lastCol = firstCol + dim - 1;
-    int firstRow = (data->mpi_rank / max) * dim + vOffset;
-    int lastRow = firstRow + dim - 1;
+    // post the receives for every band of every square before rendering
+    BandReceiver receiver;
+    if (!writesOwnRegion(data)) {
+        receiver.regions.resize(data->mpi_procs);
+        for(int n = 1; n < data->mpi_procs; n++)
+        {
+            int nFirstRow, nLastRow, nFirstCol, nLastCol;
+            blockBounds(data, n, &nFirstRow, &nLastRow, &nFirstCol, &nLastCol);
 
-    // extend processes with edge squares to cover entire scene
-    if (firstCol == hOffset){
-        firstCol = 0;
-    }
-    if (lastCol == dim * max + hOffset){
-        lastCol = data->width - 1;
-    }
-    if (firstRow == vOffset){
-        firstRow = 0;
-    }
-    if (lastRow == dim * max + vOffset || (data->mpi_procs - data->mpi_rank - 1) < max){
-        lastRow = data->height - 1;
+            StaticRegion* region = &receiver.regions[n];
+            region->rows = rowRange(nFirstRow, nLastRow);
+            region->firstCol = nFirstCol;
+            region->numCols = nLastCol - nFirstCol + 1;
+        }
+        double commStart = MPI_Wtime();
+        postBandReceives(data, &receiver);
+        commTime += MPI_Wtime() - commStart;
     }
-    std::cout << "Rank " << data->mpi_rank << " processes data in square [" << firstCol << ", " << firstRow << "] to ["
-            << lastCol << ", " << lastRow << "]" << std::endl;
     
     //Start the computation time timer.
     double compStart = MPI_Wtime();
+    perfPhase(PERF_SHADE);
 
     for (int i = 0; i < (lastRow - firstRow + 1); i++) {
         for (int j = 0; j < (lastCol - firstCol + 1); j++) {
@@ -317,60 +732,32 @@ void staticSquareBlocksMaster(ConfigData* data, float* pixels){
             int x = i + firstRow;
             int y = j + firstCol;
             if(x < (data->width - 1) && y < (data->height - 1)){
-                shadePixel(&(pixels[baseIndex]), x, y, data);
+                shadePixelCosted(&(pixels[baseIndex]), x, y, data);
             }
         }
     }
+    antialiasTile(pixels + 3 * (firstRow * data->width + firstCol), 3 * data->width,
+                  firstRow, firstCol, lastRow - firstRow + 1, lastCol - firstCol + 1, data);
     double compEnd = MPI_Wtime();
+    perfPhase(PERF_COMM);
     double masterTime = compEnd - compStart;
+    traceEvent(TRACE_SHADE, compStart, compEnd);
     compTime += masterTime;
+    liveTile(pixels + 3 * (firstRow * data->width + firstCol), 3 * data->width,
+             firstRow, firstCol, lastRow - firstRow + 1, lastCol - firstCol + 1);
+    checkpointTile(firstRow, firstCol, lastRow - firstRow + 1, lastCol - firstCol + 1);
 
-    // receive rendered scenes
-    for(int n = 1; n < data->mpi_procs; n++)
-    {
-        firstCol = (n % max) * dim + hOffset;
-        lastCol = firstCol + dim - 1;
-        firstRow = (n / max) * dim + vOffset;
-        lastRow = firstRow + dim - 1;
-
-        if (firstCol == hOffset){
-            firstCol = 0;
-        }
-        if (lastCol == dim * max + hOffset){
-            lastCol = data->width - 1;
-        }
-        if (firstRow == vOffset){
-            firstRow = 0;
-        }
-        if (lastRow == dim * max + vOffset || (data->mpi_procs - n - 1) < max){
-            lastRow = data->height - 1;
-        }
-
-        int size = (3 * (lastRow - firstRow + 1) * (lastCol - firstCol + 1)) + 1;
-        float* tempBuffer = new float[size];
-        // Receive the data into tempBuffer
-	double commStart = MPI_Wtime();
-        MPI_Recv(tempBuffer, (3 * (lastRow - firstRow + 1) * (lastCol - firstCol + 1)) + 1, MPI_FLOAT, n, 100, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-	double commEnd = MPI_Wtime();
-	commTime += commEnd - commStart;
-
-	float compTimeR= tempBuffer[3 * (lastRow - firstRow + 1) * (lastCol - firstCol + 1)];
-	compTime += compTimeR;
-
-        int masterIndex = 0;
-        int slaveIndex = 0;
-        for (int i = 0; i < (lastRow - firstRow + 1); i++) {
-            for (int j = 0; j < (lastCol - firstCol + 1); j++) {
-                masterIndex = 3 * ((i + firstRow) * data->width + (j + firstCol));
-                slaveIndex = 3 * (i * (lastCol - firstCol + 1) + j);
-                if(slaveIndex < size - 1){
-                    pixels[masterIndex] = tempBuffer[slaveIndex];
-                    pixels[masterIndex + 1] = tempBuffer[slaveIndex + 1];
-                    pixels[masterIndex + 2] = tempBuffer[slaveIndex + 2];
-                }
-            }
-        }
-        delete[] tempBuffer;
+    if (writesOwnRegion(data)) {
+        //Every process writes its own square, so only the times are collected.
+        double commStart = MPI_Wtime();
+        compTime = writeOwnRegion(data, rowRange(firstRow, lastRow), firstCol, lastCol - firstCol + 1,
+                                  pixels + 3 * (firstRow * data->width + firstCol), 3 * data->width, compTime);
+        double commEnd = MPI_Wtime();
+        commTime += commEnd - commStart;
+    }
+    else {
+        // assemble the squares band by band as they arrive
+        compTime += finishBandReceives(data, &receiver, pixels, &commTime);
     }
 
     //Print the times and the c-to-c ratio
@@ -408,77 +795,83 @@ void masterStaticCyclesHorizontal(ConfigData* data, float* pixels)
 
 
 
+    // post the receives for every band of every process's rows before rendering
+    BandReceiver receiver;
+    if (!writesOwnRegion(data) && rank == 0) {
+        receiver.regions.resize(size);
+        for (int src = 1; src < size; ++src) {
+            StaticRegion* region = &receiver.regions[src];
+            for (int startRow = src * data->cycleSize; startRow < height; startRow += data->cycleSize * size) {
+                for (int r = 0; r < data->cycleSize; ++r) {
+                    int row = startRow + r;
+                    if (row < height) region->rows.push_back(row);
+                }
+            }
+            region->firstCol = 0;
+            region->numCols = width;
+        }
+        double commStart = MPI_Wtime();
+        postBandReceives(data, &receiver);
+        communicationTime += MPI_Wtime() - commStart;
+    }
+
     double computeStart = MPI_Wtime();
+    perfPhase(PERF_SHADE);
 
     // Render local rows
-    float* localPixels = new float[3 * localRows.size() * width + 1];
+    float* localPixels = poolAcquire(3 * localRows.size() * width + 1);
     for (size_t i = 0; i < localRows.size(); ++i) {
         int row = localRows[i];
         for (int col = 0; col < width; ++col) {
             int index = 3 * (i * width + col);
-            shadePixel(&localPixels[index], row, col, data);
+            shadePixelCosted(&localPixels[index], row, col, data);
         }
     }
+    antialiasRows(localPixels, localRows, -1, NULL, data);
 
     double computeEnd = MPI_Wtime();
+    perfPhase(PERF_COMM);
     computationTime += (computeEnd - computeStart);
+    traceEvent(TRACE_SHADE, computeStart, computeEnd);
+    for (size_t i = 0; i < localRows.size(); ++i) {
+        liveTile(localPixels + 3 * i * width, 3 * width, localRows[i], 0, 1, width);
+    }
 
-    if (rank == 0) {
-        // Master copies its own results
-        for (size_t i = 0; i < localRows.size(); ++i) {
-            int row = localRows[i];
-            for (int col = 0; col < width; ++col) {
-                int srcIndex = 3 * (i * width + col);
-                int dstIndex = 3 * (row * width + col);
-                pixels[dstIndex + 0] = localPixels[srcIndex + 0];
-                pixels[dstIndex + 1] = localPixels[srcIndex + 1];
-                pixels[dstIndex + 2] = localPixels[srcIndex + 2];
-            }
-        }
-
-        // Receive from other processes
-        for (int src = 1; src < size; ++src) {
-            // Calculate number of rows for this process
-            std::vector<int> recvRows;
-            for (int startRow = src * data->cycleSize; startRow < height; startRow += data->cycleSize * size) {
-                for (int r = 0; r < data->cycleSize; ++r) {
-                    int row = startRow + r;
-                    if (row < height) recvRows.push_back(row);
-                }
-            }
-
-            int recvCount = recvRows.size() * width * 3 + 1;
-            float* recvBuffer = new float[recvCount];
-
-            double commStart = MPI_Wtime();
-            MPI_Recv(recvBuffer, recvCount, MPI_FLOAT, src, 100, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            double commEnd = MPI_Wtime();
-            communicationTime += (commEnd - commStart);
-
-            // Copy received data into the final pixel buffer
-            for (size_t i = 0; i < recvRows.size(); ++i) {
-                int row = recvRows[i];
+    if (writesOwnRegion(data)) {
+        //Every process writes its own rows, so only the times are collected.
+        double commStart = MPI_Wtime();
+        computationTime = writeOwnRegion(data, localRows, 0, width, localPixels, 3 * width, computationTime);
+        double commEnd = MPI_Wtime();
+        communicationTime += (commEnd - commStart);
+    } else {
+        if (rank == 0) {
+            // Master copies its own results
+            for (size_t i = 0; i < localRows.size(); ++i) {
+                int row = localRows[i];
                 for (int col = 0; col < width; ++col) {
                     int srcIndex = 3 * (i * width + col);
                     int dstIndex = 3 * (row * width + col);
-                    pixels[dstIndex + 0] = recvBuffer[srcIndex + 0];
-                    pixels[dstIndex + 1] = recvBuffer[srcIndex + 1];
-                    pixels[dstIndex + 2] = recvBuffer[srcIndex + 2];
+                    pixels[dstIndex + 0] = localPixels[srcIndex + 0];
+                    pixels[dstIndex + 1] = localPixels[srcIndex + 1];
+                    pixels[dstIndex + 2] = localPixels[srcIndex + 2];
                 }
+                checkpointTile(row, 0, 1, width);
             }
 
-            delete[] recvBuffer;
+            // assemble the rows band by band as they arrive
+            computationTime += finishBandReceives(data, &receiver, pixels, &communicationTime);
+        } else {
+            // Send data to master
+            int sendCount = localRows.size() * width * 3;
+            double commStart = MPI_Wtime();
+            MPI_Send(localPixels, sendCount, MPI_FLOAT, 0, 100, renderComm);
+            double commEnd = MPI_Wtime();
+            communicationTime += (commEnd - commStart);
+            traceEvent(TRACE_SEND, commStart, commEnd, 0);
         }
-    } else {
-        // Send data to master
-        int sendCount = localRows.size() * width * 3;
-        double commStart = MPI_Wtime();
-        MPI_Send(localPixels, sendCount, MPI_FLOAT, 0, 100, MPI_COMM_WORLD);
-        double commEnd = MPI_Wtime();
-        communicationTime += (commEnd - commStart);
     }
 
-    delete[] localPixels;
+    poolRelease(localPixels);
 
     //Print the times and the c-to-c ratio
         //This section of printing, IN THIS ORDER, needs to be included in all of the
@@ -495,6 +888,7 @@ void masterSequential(ConfigData* data, float* pixels)
 {
     //Start the computation time timer.
     double computationStart = MPI_Wtime();
+    perfPhase(PERF_SHADE);
 
     //Render the scene.
     for( int i = 0; i < data->height; ++i )
@@ -508,13 +902,25 @@ void masterSequential(ConfigData* data, float* pixels)
             int baseIndex = 3 * ( row * data->width + column );
 
             //Call the function to shade the pixel.
-            shadePixel(&(pixels[baseIndex]),row,j,data);
+            shadePixelCosted(&(pixels[baseIndex]),row,j,data);
+        }
+        liveTile(pixels + 3 * i * data->width, 3 * data->width, i, 0, 1, data->width);
+        //With -aa the rows change again below.
+        if (runOptions.aaThreshold <= 0.0f) {
+            checkpointTile(i, 0, 1, data->width);
         }
     }
+    antialiasTile(pixels, 3 * data->width, 0, 0, data->height, data->width, data);
+    if (runOptions.aaThreshold > 0.0f) {
+        liveTile(pixels, 3 * data->width, 0, 0, data->height, data->width);
+        checkpointTile(0, 0, data->height, data->width);
+    }
 
     //Stop the comp. timer
     double computationStop = MPI_Wtime();
+    perfPhase(PERF_COMM);
     double computationTime = computationStop - computationStart;
+    traceEvent(TRACE_SHADE, computationStart, computationStop);
 
     //After receiving from all processes, the communication time will
     //be obtained.
@@ -0,0 +1,176 @@
+//This file contains the output path where every process writes its own part
+//of the image with MPI-IO instead of sending it to the master.
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+#include "mpi_output.h"
+#include "png_writer.h"
+#include "trace.h"
+#include "batch.h"
+
+std::string outputHeader(OutputFormat format, int width, int height)
+{
+    std::ostringstream header;
+    switch (format)
+    {
+        case OUTPUT_PFM:
+            //A negative scale marks the floats as little endian.
+            header << "PF\n" << width << " " << height << "\n-1.0\n";
+            break;
+
+        case OUTPUT_PPM:
+            header << "P6\n" << width << " " << height << "\n255\n";
+            break;
+
+        default:
+            break;
+    }
+    return header.str();
+}
+
+std::string renderFileName()
+{
+    std::string file = "renders/" + generateFileName();
+    size_t dot = file.find_last_of('.');
+    if (dot == std::string::npos || dot < file.find_last_of('/')) {
+        dot = file.size();
+    }
+    return file.insert(dot, runOptions.fileTag);
+}
+
+std::string shareOutputFileName(ConfigData* data, OutputFormat format)
+{
+    char name[256];
+    memset(name, 0, sizeof(name));
+
+    if (data->mpi_rank == 0) {
+        std::string file = renderFileName();
+        file = file.substr(0, file.find_last_of('.'));
+        switch (format)
+        {
+            case OUTPUT_RAW: file += ".raw"; break;
+            case OUTPUT_PFM: file += ".pfm"; break;
+            case OUTPUT_PPM: file += ".ppm"; break;
+            default: file += ".png"; break;
+        }
+        strncpy(name, file.c_str(), sizeof(name) - 1);
+    }
+
+    MPI_Bcast(name, sizeof(name), MPI_CHAR, 0, renderComm);
+    return std::string(name);
+}
+
+bool writeRowsCollective(MPI_Comm comm, std::string filename, ConfigData* data, OutputFormat format,
+                         const std::vector<int>& rows, int firstCol, int numCols,
+                         const float* pixels, int stride)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    std::string header = outputHeader(format, data->width, data->height);
+    int valueBytes = format == OUTPUT_PPM ? 1 : sizeof(float);
+
+    //Never write outside of the image.
+    if (firstCol + numCols > data->width) {
+        numCols = data->width - firstCol;
+    }
+    int rowBytes = 3 * numCols * valueBytes;
+
+    //PFM stores the bottom row first. The file view needs its pieces in
+    //increasing file order, so sort the rows by where they land.
+    std::vector<int> fileRows;
+    std::vector<int> order;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (rows[i] < 0 || rows[i] >= data->height || numCols <= 0) continue;
+        fileRows.push_back(format == OUTPUT_PFM ? data->height - 1 - rows[i] : rows[i]);
+        order.push_back(i);
+    }
+    int count = order.size();
+    std::vector<int> sorted(count);
+    for (int k = 0; k < count; ++k) {
+        sorted[k] = k;
+    }
+    std::sort(sorted.begin(), sorted.end(), [&](int a, int b) { return fileRows[a] < fileRows[b]; });
+
+    std::vector<char> buffer((size_t)count * rowBytes);
+    std::vector<int> lengths(count, rowBytes);
+    std::vector<MPI_Aint> displacements(count);
+    for (int k = 0; k < count; ++k) {
+        int j = sorted[k];
+        displacements[k] = header.size() + ((MPI_Aint)fileRows[j] * data->width + firstCol) * 3 * valueBytes;
+
+        const float* source = pixels + (size_t)order[j] * stride;
+        char* target = &buffer[(size_t)k * rowBytes];
+        if (format == OUTPUT_PPM) {
+            floatToRGB8((unsigned char*)target, source, 3 * numCols);
+        } else {
+            memcpy(target, source, rowBytes);
+        }
+    }
+
+    MPI_File fh;
+    if (MPI_File_open(comm, filename.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        std::cerr << "Could not open " << filename << " for writing!" << std::endl;
+        return false;
+    }
+
+    //Size the file up front so that it is complete even if some pixels
+    //are not covered by any process.
+    MPI_File_set_size(fh, header.size() + (MPI_Offset)data->width * data->height * 3 * valueBytes);
+
+    if (rank == 0 && header.size() > 0) {
+        MPI_File_write_at(fh, 0, header.c_str(), header.size(), MPI_CHAR, MPI_STATUS_IGNORE);
+    }
+
+    //Describe where this process's rows go, then write them all at once.
+    MPI_Datatype filetype = MPI_BYTE;
+    if (count > 0) {
+        MPI_Type_create_hindexed(count, &lengths[0], &displacements[0], MPI_BYTE, &filetype);
+        MPI_Type_commit(&filetype);
+    }
+    MPI_File_set_view(fh, 0, MPI_BYTE, filetype, "native", MPI_INFO_NULL);
+
+    int result = MPI_File_write_at_all(fh, 0, count > 0 ? &buffer[0] : NULL, buffer.size(), MPI_BYTE, MPI_STATUS_IGNORE);
+
+    MPI_File_close(&fh);
+    if (count > 0) {
+        MPI_Type_free(&filetype);
+    }
+    return result == MPI_SUCCESS;
+}
+
+bool writesOwnRegion(ConfigData* data)
+{
+    //The master composites the region over the old render, so it needs
+    //every pixel.
+    if (runOptions.outputFormat == OUTPUT_PNG || !runOptions.roiBase.empty()) {
+        return false;
+    }
+    return data->partitioningMode == PART_MODE_STATIC_STRIPS_VERTICAL
+        || data->partitioningMode == PART_MODE_STATIC_BLOCKS
+        || data->partitioningMode == PART_MODE_STATIC_CYCLES_HORIZONTAL;
+}
+
+double writeOwnRegion(ConfigData* data, const std::vector<int>& rows, int firstCol, int numCols,
+                      const float* pixels, int stride, double computationTime)
+{
+    double saveStart = traceNow();
+    writeRowsCollective(renderComm, runOptions.outputFile, data, runOptions.outputFormat,
+                        rows, firstCol, numCols, pixels, stride);
+    traceEvent(TRACE_SAVE, saveStart, traceNow());
+
+    double totalTime = 0.0;
+    MPI_Reduce(&computationTime, &totalTime, 1, MPI_DOUBLE, MPI_SUM, 0, renderComm);
+    return totalTime;
+}
+
+std::vector<int> rowRange(int firstRow, int lastRow)
+{
+    std::vector<int> rows;
+    for (int row = firstRow; row <= lastRow; ++row) {
+        rows.push_back(row);
+    }
+    return rows;
+}
@@ -0,0 +1,296 @@
+//This file contains the parsing of the options that the engine does not handle.
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "options.h"
+
+RunOptions runOptions;
+
+//Read the value that follows an option. Returns false if it is missing.
+static bool readString(int argc, char* argv[], int* i, char** value)
+{
+    if (*i + 1 >= argc) {
+        std::cerr << "ERROR: " << argv[*i] << " requires a value" << std::endl;
+        return false;
+    }
+    *i += 1;
+    *value = argv[*i];
+    return true;
+}
+
+static bool readInt(int argc, char* argv[], int* i, int* value)
+{
+    char* text;
+    if (!readString(argc, argv, i, &text)) return false;
+    *value = atoi(text);
+    return true;
+}
+
+static bool readDouble(int argc, char* argv[], int* i, double* value)
+{
+    char* text;
+    if (!readString(argc, argv, i, &text)) return false;
+    *value = atof(text);
+    return true;
+}
+
+bool parseRunOptions(int* argc, char** argv[], RunOptions* options)
+{
+    //Defaults
+    options->pngParallel = false;
+    options->pngLevel = 6;
+    options->pngThreads = 0;
+    options->outputFormat = OUTPUT_PNG;
+    options->speculate = false;
+    options->bands = 8;
+    options->hybrid = false;
+    options->staticFraction = 0.8;
+    options->bindMode = BIND_NONE;
+    options->costCols = 0;
+    options->costRows = 0;
+    options->traceFile = "";
+    options->aaThreshold = 0.0f;
+    options->roiX = options->roiY = 0;
+    options->roiWidth = options->roiHeight = 0;
+    options->roiBase = "";
+    options->perf = false;
+    options->rayStats = false;
+    options->compress = false;
+    options->batchFile = "";
+    options->packRanks = 0;
+    options->fileTag = "";
+    options->liveSocket = "";
+    options->weighted = false;
+    options->weightsFile = "";
+    options->lptSource = "";
+    options->sceneFile = "";
+    options->incrementalScene = "";
+    options->incrementalBase = "";
+    options->checkpointFile = "";
+    options->checkpointInterval = 60.0;
+    options->resumeFile = "";
+    options->renderThreads = 0;
+    options->threadChecks = 0;
+
+    int kept = 1;
+    for (int i = 1; i < *argc; ++i) {
+        char* arg = (*argv)[i];
+
+        if (strcmp(arg, "-zl") == 0) {
+            if (!readInt(*argc, *argv, &i, &options->pngLevel)) return true;
+            options->pngParallel = true;
+            if (options->pngLevel < 0 || options->pngLevel > 9) {
+                std::cerr << "ERROR: -zl <level> must be between 0 and 9" << std::endl;
+                return true;
+            }
+        }
+        else if (strcmp(arg, "-zt") == 0) {
+            if (!readInt(*argc, *argv, &i, &options->pngThreads)) return true;
+            options->pngParallel = true;
+        }
+        else if (strcmp(arg, "-out") == 0) {
+            char* format;
+            if (!readString(*argc, *argv, &i, &format)) return true;
+            if (strcmp(format, "png") == 0) options->outputFormat = OUTPUT_PNG;
+            else if (strcmp(format, "raw") == 0) options->outputFormat = OUTPUT_RAW;
+            else if (strcmp(format, "pfm") == 0) options->outputFormat = OUTPUT_PFM;
+            else if (strcmp(format, "ppm") == 0) options->outputFormat = OUTPUT_PPM;
+            else {
+                std::cerr << "ERROR: -out <format> must be png, raw, pfm or ppm" << std::endl;
+                return true;
+            }
+        }
+        else if (strcmp(arg, "-spec") == 0) {
+            options->speculate = true;
+        }
+        else if (strcmp(arg, "-p") == 0 && i + 1 < *argc && strcmp((*argv)[i + 1], "hybrid") == 0) {
+            //The engine does not know this mode. It needs the same block
+            //size as dynamic, so it is passed on as dynamic.
+            options->hybrid = true;
+            (*argv)[kept++] = arg;
+            (*argv)[kept++] = (char*)"dynamic";
+            ++i;
+        }
+        else if (strcmp(arg, "-c") == 0 && i + 1 < *argc) {
+            //The engine reads the scene; -incremental needs its name too.
+            options->sceneFile = (*argv)[i + 1];
+            (*argv)[kept++] = arg;
+            (*argv)[kept++] = (*argv)[++i];
+        }
+        else if (strcmp(arg, "-bands") == 0) {
+            if (!readInt(*argc, *argv, &i, &options->bands)) return true;
+            if (options->bands < 1) {
+                std::cerr << "ERROR: -bands <count> must be at least 1" << std::endl;
+                return true;
+            }
+        }
+        else if (strcmp(arg, "-sf") == 0) {
+            if (!readDouble(*argc, *argv, &i, &options->staticFraction)) return true;
+            if (options->staticFraction < 0.0 || options->staticFraction > 1.0) {
+                std::cerr << "ERROR: -sf <fraction> must be between 0 and 1" << std::endl;
+                return true;
+            }
+        }
+        else if (strcmp(arg, "-bind") == 0) {
+            char* mode;
+            if (!readString(*argc, *argv, &i, &mode)) return true;
+            if (strcmp(mode, "none") == 0) options->bindMode = BIND_NONE;
+            else if (strcmp(mode, "compact") == 0) options->bindMode = BIND_COMPACT;
+            else if (strcmp(mode, "scatter") == 0) options->bindMode = BIND_SCATTER;
+            else {
+                std::cerr << "ERROR: -bind <mode> must be none, compact or scatter" << std::endl;
+                return true;
+            }
+        }
+        else if (strcmp(arg, "-costmap") == 0) {
+            char* size;
+            if (!readString(*argc, *argv, &i, &size)) return true;
+            //A single number gives a square grid.
+            int fields = sscanf(size, "%dx%d", &options->costCols, &options->costRows);
+            if (fields == 1) options->costRows = options->costCols;
+            if (fields < 1 || options->costCols <= 0 || options->costRows <= 0) {
+                std::cerr << "ERROR: -costmap <cols>x<rows> must be positive" << std::endl;
+                return true;
+            }
+        }
+        else if (strcmp(arg, "-trace") == 0) {
+            char* file;
+            if (!readString(*argc, *argv, &i, &file)) return true;
+            options->traceFile = file;
+        }
+        else if (strcmp(arg, "-aa") == 0) {
+            double threshold;
+            if (!readDouble(*argc, *argv, &i, &threshold)) return true;
+            if (threshold <= 0.0) {
+                std::cerr << "ERROR: -aa <threshold> must be greater than 0" << std::endl;
+                return true;
+            }
+            options->aaThreshold = threshold;
+        }
+        else if (strcmp(arg, "-roi") == 0) {
+            char* region;
+            if (!readString(*argc, *argv, &i, &region)) return true;
+            if (sscanf(region, "%d,%d,%d,%d", &options->roiX, &options->roiY, &options->roiWidth, &options->roiHeight) != 4
+                || options->roiWidth <= 0 || options->roiHeight <= 0) {
+                std::cerr << "ERROR: -roi must be given as x,y,width,height" << std::endl;
+                return true;
+            }
+        }
+        else if (strcmp(arg, "-roi-over") == 0) {
+            char* file;
+            if (!readString(*argc, *argv, &i, &file)) return true;
+            options->roiBase = file;
+        }
+        else if (strcmp(arg, "-perf") == 0) {
+            options->perf = true;
+        }
+        else if (strcmp(arg, "-raystats") == 0) {
+            options->rayStats = true;
+        }
+        else if (strcmp(arg, "-compress") == 0) {
+            options->compress = true;
+        }
+        else if (strcmp(arg, "-batch") == 0) {
+            char* file;
+            if (!readString(*argc, *argv, &i, &file)) return true;
+            options->batchFile = file;
+        }
+        else if (strcmp(arg, "-pack") == 0) {
+            if (!readInt(*argc, *argv, &i, &options->packRanks)) return true;
+            if (options->packRanks < 1) {
+                std::cerr << "ERROR: -pack <ranks> must be at least 1" << std::endl;
+                return true;
+            }
+        }
+        else if (strcmp(arg, "-live") == 0) {
+            char* path;
+            if (!readString(*argc, *argv, &i, &path)) return true;
+            options->liveSocket = path;
+        }
+        else if (strcmp(arg, "-weighted") == 0) {
+            options->weighted = true;
+        }
+        else if (strcmp(arg, "-weights") == 0) {
+            char* file;
+            if (!readString(*argc, *argv, &i, &file)) return true;
+            options->weightsFile = file;
+            options->weighted = true;
+        }
+        else if (strcmp(arg, "-lpt") == 0) {
+            char* source;
+            if (!readString(*argc, *argv, &i, &source)) return true;
+            options->lptSource = source;
+        }
+        else if (strcmp(arg, "-incremental") == 0) {
+            char* files;
+            if (!readString(*argc, *argv, &i, &files)) return true;
+            std::string value = files;
+            size_t comma = value.rfind(',');
+            if (comma == std::string::npos || comma == 0 || comma + 1 == value.size()) {
+                std::cerr << "ERROR: -incremental must be given as <scene before>,<render before>.png" << std::endl;
+                return true;
+            }
+            options->incrementalScene = value.substr(0, comma);
+            options->incrementalBase = value.substr(comma + 1);
+        }
+        else if (strcmp(arg, "-checkpoint") == 0) {
+            char* file;
+            if (!readString(*argc, *argv, &i, &file)) return true;
+            //The interval can follow the file name after a comma.
+            std::string value = file;
+            size_t comma = value.rfind(',');
+            options->checkpointFile = value.substr(0, comma);
+            if (comma != std::string::npos) {
+                options->checkpointInterval = atof(value.c_str() + comma + 1);
+            }
+            if (options->checkpointFile.empty() || options->checkpointInterval <= 0.0) {
+                std::cerr << "ERROR: -checkpoint must be given as <file>[,<seconds>]" << std::endl;
+                return true;
+            }
+        }
+        else if (strcmp(arg, "-resume") == 0) {
+            char* file;
+            if (!readString(*argc, *argv, &i, &file)) return true;
+            options->resumeFile = file;
+        }
+        else if (strcmp(arg, "-t") == 0) {
+            if (!readInt(*argc, *argv, &i, &options->renderThreads)) return true;
+            if (options->renderThreads < 1) {
+                std::cerr << "ERROR: -t <threads> must be at least 1" << std::endl;
+                return true;
+            }
+        }
+        else if (strcmp(arg, "-tcheck") == 0) {
+            if (!readInt(*argc, *argv, &i, &options->threadChecks)) return true;
+            if (options->threadChecks < 1) {
+                std::cerr << "ERROR: -tcheck <runs> must be at least 1" << std::endl;
+                return true;
+            }
+        }
+        else {
+            //Not ours, leave it for the engine.
+            (*argv)[kept++] = arg;
+        }
+    }
+
+    if (options->packRanks > 0 && options->batchFile.empty()) {
+        std::cerr << "ERROR: -pack needs -batch" << std::endl;
+        return true;
+    }
+
+    if (options->threadChecks > 0 && options->renderThreads == 0) {
+        std::cerr << "ERROR: -tcheck needs -t" << std::endl;
+        return true;
+    }
+
+    if (!options->roiBase.empty() && options->roiWidth <= 0) {
+        std::cerr << "ERROR: -roi-over needs -roi" << std::endl;
+        return true;
+    }
+
+    (*argv)[kept] = NULL;
+    *argc = kept;
+    return false;
+}
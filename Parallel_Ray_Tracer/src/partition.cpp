@@ -0,0 +1,184 @@
+//This file contains the geometry that is shared by the master and the slaves.
+
+#include <algorithm>
+#include <math.h>
+#include "partition.h"
+#include "options.h"
+
+std::vector<double> rankWeights;
+
+//Cut total into count pieces in proportion to weights[0 .. count - 1].
+//Every piece gets at least one unit when there are enough of them; piece
+//i runs from cuts[i] to cuts[i + 1] - 1.
+static void weightedCuts(const double* weights, int count, int total, std::vector<int>* cuts)
+{
+    double sum = 0.0;
+    for (int i = 0; i < count; ++i) {
+        sum += weights[i];
+    }
+
+    cuts->assign(count + 1, 0);
+    double running = 0.0;
+    for (int i = 1; i < count; ++i) {
+        running += weights[i - 1];
+        int cut = (int)floor(total * running / sum + 0.5);
+        if (total >= count) {
+            cut = std::max(cut, (*cuts)[i - 1] + 1);
+            cut = std::min(cut, total - (count - i));
+        }
+        (*cuts)[i] = cut;
+    }
+    (*cuts)[count] = total;
+}
+
+UnitGrid unitGrid(ConfigData* data, int firstCol)
+{
+    UnitGrid grid;
+    grid.firstCol = firstCol;
+    grid.blockWidth = data->dynamicBlockWidth;
+    grid.blockHeight = data->dynamicBlockHeight;
+    grid.width = data->width;
+    grid.height = data->height;
+
+    int unitRows = (grid.height + grid.blockHeight - 1) / grid.blockHeight;
+    grid.unitCols = std::max(0, (grid.width - firstCol + grid.blockWidth - 1) / grid.blockWidth);
+    grid.count = grid.unitCols * unitRows;
+    return grid;
+}
+
+WorkUnit unitAt(const UnitGrid* grid, int index)
+{
+    WorkUnit unit;
+    unit.id = index;
+    unit.startRow = (index / grid->unitCols) * grid->blockHeight;
+    unit.startCol = grid->firstCol + (index % grid->unitCols) * grid->blockWidth;
+    // overflow check
+    unit.blockHeight = std::min(grid->blockHeight, grid->height - unit.startRow);
+    unit.blockWidth = std::min(grid->blockWidth, grid->width - unit.startCol);
+    return unit;
+}
+
+int createDynamicUnits(ConfigData* data, int firstCol, std::queue<WorkUnit>* queue)
+{
+    UnitGrid grid = unitGrid(data, firstCol);
+    for (int i = 0; i < grid.count; ++i) {
+        queue->push(unitAt(&grid, i));
+    }
+    return grid.count;
+}
+
+int hybridStripColumns(ConfigData* data, int rank, int* firstCol, int* lastCol)
+{
+    int staticCols = (int)(data->width * runOptions.staticFraction);
+    int cols = staticCols / data->mpi_procs;
+    int extra = staticCols % data->mpi_procs;
+
+    *firstCol = rank * cols;
+    *lastCol = *firstCol + cols - 1;
+    if (rank == data->mpi_procs - 1) {
+        *lastCol += extra;
+    }
+    return staticCols;
+}
+
+void stripColumns(ConfigData* data, int rank, int* firstCol, int* lastCol)
+{
+    if (rankWeights.empty()) {
+        int cols = data->width / data->mpi_procs;
+        int extra = data->width % data->mpi_procs;
+        *firstCol = rank * cols;
+        *lastCol = *firstCol + cols - 1;
+        if (rank == data->mpi_procs - 1) {
+            *lastCol += extra;
+        }
+        return;
+    }
+
+    std::vector<int> cuts;
+    weightedCuts(&rankWeights[0], data->mpi_procs, data->width, &cuts);
+    *firstCol = cuts[rank];
+    *lastCol = cuts[rank + 1] - 1;
+}
+
+void blockBounds(ConfigData* data, int rank, int* firstRow, int* lastRow, int* firstCol, int* lastCol)
+{
+    if (rankWeights.empty()) {
+        // dividing into square blocks
+        int square = 0;
+        int root = (int) sqrt(data->mpi_procs);
+        float test = (float)data->mpi_procs / (float)root;
+        if(test != root){
+            square = ((int)sqrt(data->mpi_procs) + 1) * ((int)sqrt(data->mpi_procs) + 1);
+        }else{
+            square = data->mpi_procs;
+        }
+
+        int size = (data->width)*(data->height) / square;  // divide total number of elements into sqaures
+        int dim = sqrt(size);
+
+        int max = data->width / dim;
+        int hOffset = (data->width - (dim * max));
+        if(hOffset > 1){
+            hOffset /= 2;
+        }
+        int vOffset = (data->height - (dim * max));
+        if(vOffset > 1){
+            vOffset /= 2;
+        }
+
+        *firstCol = (rank % max) * dim + hOffset;
+        *lastCol = *firstCol + dim - 1;
+        *firstRow = (rank / max) * dim + vOffset;
+        *lastRow = *firstRow + dim - 1;
+
+        // extend processes with edge squares to cover entire scene
+        if (*firstCol == hOffset){
+            *firstCol = 0;
+        }
+        if (*lastCol == dim * max + hOffset){
+            *lastCol = data->width - 1;
+        }
+        if (*firstRow == vOffset){
+            *firstRow = 0;
+        }
+        if (*lastRow == dim * max + vOffset || (data->mpi_procs - rank - 1) < max){
+            *lastRow = data->height - 1;
+        }
+        return;
+    }
+
+    int procs = data->mpi_procs;
+    int gridCols = (int)ceil(sqrt((double)procs));
+    int gridRows = (procs + gridCols - 1) / gridCols;
+
+    //The height of each row of the grid follows the weight of its processes.
+    std::vector<double> rowWeights(gridRows, 0.0);
+    for (int r = 0; r < procs; ++r) {
+        rowWeights[r / gridCols] += rankWeights[r];
+    }
+    std::vector<int> rowCuts;
+    weightedCuts(&rowWeights[0], gridRows, data->height, &rowCuts);
+
+    int gridRow = rank / gridCols;
+    int first = gridRow * gridCols;
+    int count = std::min(gridCols, procs - first);
+    std::vector<int> colCuts;
+    weightedCuts(&rankWeights[first], count, data->width, &colCuts);
+
+    *firstRow = rowCuts[gridRow];
+    *lastRow = rowCuts[gridRow + 1] - 1;
+    *firstCol = colCuts[rank - first];
+    *lastCol = colCuts[rank - first + 1] - 1;
+}
+
+int bandCount(int numRows)
+{
+    return std::max(1, std::min(runOptions.bands, numRows));
+}
+
+void bandRows(int numRows, int band, int* first, int* count)
+{
+    int bands = bandCount(numRows);
+    *first = (int)((long)numRows * band / bands);
+    *count = (int)((long)numRows * (band + 1) / bands) - *first;
+}
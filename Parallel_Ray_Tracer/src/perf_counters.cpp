@@ -0,0 +1,171 @@
+//This file contains the hardware counters used by -perf.
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "perf_counters.h"
+
+PerfStats perfStats;
+bool perfEnabled = false;
+
+static const char* eventNames[PERF_EVENTS] = { "cycles", "instructions", "LLC misses", "branch misses" };
+static const unsigned long long eventConfigs[PERF_EVENTS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+//The group leader, the place of each event in a group read (-1 when it
+//could not be opened) and the readings at the last phase switch.
+static int groupFd = -1;
+static int slots[PERF_EVENTS];
+static int members = 0;
+static PerfPhase currentPhase = PERF_OFF;
+static unsigned long long lastValues[PERF_EVENTS];
+static unsigned long long lastEnabled = 0;
+static unsigned long long lastRunning = 0;
+
+//Why the counters could not be opened.
+static std::string unavailable = "not opened";
+
+static int openEvent(unsigned long long config, int leader)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = leader < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+}
+
+//Read every event of the group at once, in the order of slots.
+static bool readGroup(unsigned long long* values, unsigned long long* enabled, unsigned long long* running)
+{
+    unsigned long long buffer[3 + PERF_EVENTS];
+    ssize_t expected = sizeof(unsigned long long) * (3 + members);
+    if (read(groupFd, buffer, sizeof(buffer)) < expected) {
+        return false;
+    }
+    *enabled = buffer[1];
+    *running = buffer[2];
+    for (int e = 0; e < PERF_EVENTS; ++e) {
+        values[e] = slots[e] >= 0 ? buffer[3 + slots[e]] : 0;
+    }
+    return true;
+}
+
+bool perfInit()
+{
+    memset(&perfStats, 0, sizeof(perfStats));
+    currentPhase = PERF_OFF;
+
+    //Still open from an earlier job of a batch, so only start again.
+    if (groupFd >= 0) {
+        for (int e = 0; e < PERF_EVENTS; ++e) {
+            perfStats.processes[e] = slots[e] >= 0 ? 1 : 0;
+        }
+        perfEnabled = readGroup(lastValues, &lastEnabled, &lastRunning);
+        return perfEnabled;
+    }
+
+    groupFd = openEvent(eventConfigs[0], -1);
+    if (groupFd < 0) {
+        switch (errno)
+        {
+            case EACCES:
+            case EPERM:
+                unavailable = "not permitted, see /proc/sys/kernel/perf_event_paranoid";
+                break;
+            case ENOSYS:
+                unavailable = "the kernel has no perf events";
+                break;
+            default:
+                unavailable = std::string("no hardware counters (") + strerror(errno) + ")";
+                break;
+        }
+        return false;
+    }
+
+    slots[0] = 0;
+    members = 1;
+    perfStats.processes[0] = 1;
+    for (int e = 1; e < PERF_EVENTS; ++e) {
+        //Virtual machines often have cycles but not the cache events.
+        int fd = openEvent(eventConfigs[e], groupFd);
+        slots[e] = fd < 0 ? -1 : members++;
+        perfStats.processes[e] = fd < 0 ? 0 : 1;
+    }
+
+    ioctl(groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    if (!readGroup(lastValues, &lastEnabled, &lastRunning)) {
+        unavailable = "the counters could not be read";
+        close(groupFd);
+        groupFd = -1;
+        memset(&perfStats, 0, sizeof(perfStats));
+        return false;
+    }
+
+    perfEnabled = true;
+    return true;
+}
+
+void perfSwitch(PerfPhase phase)
+{
+    unsigned long long values[PERF_EVENTS], enabled, running;
+    if (!readGroup(values, &enabled, &running)) {
+        return;
+    }
+
+    if (currentPhase != PERF_OFF) {
+        //Scale up the counts if the group had to share the hardware.
+        double scale = 1.0;
+        if (running > lastRunning && enabled - lastEnabled > running - lastRunning) {
+            scale = (double)(enabled - lastEnabled) / (running - lastRunning);
+        }
+        for (int e = 0; e < PERF_EVENTS; ++e) {
+            perfStats.counts[currentPhase][e] += (long long)((values[e] - lastValues[e]) * scale);
+        }
+    }
+
+    memcpy(lastValues, values, sizeof(values));
+    lastEnabled = enabled;
+    lastRunning = running;
+    currentPhase = phase;
+}
+
+void printPerfStats(const PerfStats* stats, long long pixels, int processes)
+{
+    if (stats->processes[0] == 0) {
+        std::cout << "Hardware Counters: unavailable (" << unavailable << ")" << std::endl;
+        return;
+    }
+
+    static const char* phaseNames[PERF_PHASES] = { "Shading", "Communication" };
+    std::cout << "Hardware Counters per Pixel (" << stats->processes[0] << " of " << processes << " processes):" << std::endl;
+    for (int p = 0; p < PERF_PHASES; ++p) {
+        std::cout << "    " << phaseNames[p] << ":";
+        for (int e = 0; e < PERF_EVENTS; ++e) {
+            std::cout << (e > 0 ? "," : "") << " " << eventNames[e] << " ";
+            if (stats->processes[e] == 0) {
+                std::cout << "n/a";
+                continue;
+            }
+            std::cout << (double)stats->counts[p][e] / pixels;
+            if (e == 1 && stats->counts[p][0] > 0) {
+                std::cout << " (IPC " << (double)stats->counts[p][1] / stats->counts[p][0] << ")";
+            }
+        }
+        std::cout << std::endl;
+    }
+}
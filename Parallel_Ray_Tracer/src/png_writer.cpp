@@ -0,0 +1,279 @@
+//This file contains a PNG writer that spreads the conversion, filtering and
+//compression of the image over several threads.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+#include <emmintrin.h>
+#include "png_writer.h"
+
+//Deflate keeps a 32K window, so that is how much of the previous band is
+//given to the next band as a dictionary.
+#define DEFLATE_WINDOW 32768
+
+//Run func(0) ... func(count - 1) over the given number of threads.
+template <typename Func>
+static void runParallel(int threads, int count, Func func)
+{
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i = next++; i < count; i = next++) {
+            func(i);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) {
+        pool.push_back(std::thread(worker));
+    }
+    worker();
+    for (size_t t = 0; t < pool.size(); ++t) {
+        pool[t].join();
+    }
+}
+
+void floatToRGB8(unsigned char* out, const float* in, int count)
+{
+    //The engine writes (int)(v * 255) and anything above 1.0 as 255.
+    //The packs saturate anything below zero to 0.
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128i full = _mm_set1_epi32(255);
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i q[4];
+        for (int k = 0; k < 4; ++k) {
+            __m128 v = _mm_loadu_ps(in + i + 4 * k);
+            __m128i over = _mm_castps_si128(_mm_cmpgt_ps(v, one));
+            __m128i t = _mm_cvttps_epi32(_mm_mul_ps(v, scale));
+            q[k] = _mm_or_si128(_mm_and_si128(over, full), _mm_andnot_si128(over, t));
+        }
+        __m128i lo = _mm_packs_epi32(q[0], q[1]);
+        __m128i hi = _mm_packs_epi32(q[2], q[3]);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(lo, hi));
+    }
+    for (; i < count; ++i) {
+        float v = in[i];
+        if (v > 1.0f) {
+            out[i] = 255;
+        } else {
+            int t = (int)(v * 255.0f);
+            out[i] = (unsigned char)(t < 0 ? 0 : t);
+        }
+    }
+}
+
+static int paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+//Filter one row with each of the five PNG filters and keep the one with the
+//smallest sum of absolute values, the same heuristic that libpng uses.
+static void filterRow(unsigned char* out, const unsigned char* row, const unsigned char* prev, int rowBytes)
+{
+    std::vector<unsigned char> trial(rowBytes);
+    long best = -1;
+
+    for (int type = 0; type < 5; ++type) {
+        long sum = 0;
+        for (int x = 0; x < rowBytes; ++x) {
+            int a = x >= 3 ? row[x - 3] : 0;
+            int b = prev ? prev[x] : 0;
+            int c = (prev && x >= 3) ? prev[x - 3] : 0;
+            int predict = 0;
+            switch (type) {
+                case 1: predict = a; break;
+                case 2: predict = b; break;
+                case 3: predict = (a + b) / 2; break;
+                case 4: predict = paeth(a, b, c); break;
+            }
+            unsigned char value = (unsigned char)(row[x] - predict);
+            trial[x] = value;
+            sum += value < 128 ? value : 256 - value;
+        }
+        if (best < 0 || sum < best) {
+            best = sum;
+            out[0] = (unsigned char)type;
+            memcpy(out + 1, &trial[0], rowBytes);
+        }
+    }
+}
+
+//Deflate one band as a raw stream. Every band but the last ends on a byte
+//boundary with a sync flush so that the streams can be joined together.
+static bool deflateBand(std::vector<unsigned char>* out, const unsigned char* in, size_t length,
+                        const unsigned char* dictionary, size_t dictionaryLength, int level, bool last)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    if (dictionaryLength > 0) {
+        deflateSetDictionary(&stream, dictionary, dictionaryLength);
+    }
+
+    out->resize(deflateBound(&stream, length) + 64);
+    stream.next_in = (Bytef*)in;
+    stream.avail_in = length;
+    stream.next_out = &(*out)[0];
+    stream.avail_out = out->size();
+
+    int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    int status = deflate(&stream, flush);
+    while ((last && status != Z_STREAM_END) || (!last && stream.avail_out == 0)) {
+        if (status != Z_OK && status != Z_BUF_ERROR) {
+            deflateEnd(&stream);
+            return false;
+        }
+        size_t used = out->size() - stream.avail_out;
+        out->resize(out->size() * 2);
+        stream.next_out = &(*out)[used];
+        stream.avail_out = out->size() - used;
+        status = deflate(&stream, flush);
+    }
+
+    out->resize(out->size() - stream.avail_out);
+    deflateEnd(&stream);
+    return true;
+}
+
+static void putUint32(unsigned char* out, unsigned long value)
+{
+    out[0] = (value >> 24) & 0xff;
+    out[1] = (value >> 16) & 0xff;
+    out[2] = (value >> 8) & 0xff;
+    out[3] = value & 0xff;
+}
+
+static void writeChunk(FILE* fp, const char* type, const unsigned char* body, size_t length)
+{
+    unsigned char word[4];
+    putUint32(word, length);
+    fwrite(word, 1, 4, fp);
+    fwrite(type, 1, 4, fp);
+    if (length > 0) {
+        fwrite(body, 1, length, fp);
+    }
+
+    unsigned long crc = crc32(0L, (const Bytef*)type, 4);
+    if (length > 0) {
+        crc = crc32(crc, body, length);
+    }
+    putUint32(word, crc);
+    fwrite(word, 1, 4, fp);
+}
+
+bool savePixelsParallel(std::string filename, float* pixels, ConfigData* data, int level, int threads)
+{
+    int width = data->width;
+    int height = data->height;
+    size_t rowBytes = 3 * (size_t)width;
+    size_t filteredRow = rowBytes + 1;
+
+    if (threads <= 0) {
+        threads = std::thread::hardware_concurrency();
+        if (threads <= 0) threads = 1;
+    }
+
+    //Split the rows into bands; a few per thread keeps the threads busy.
+    int bands = threads * 4;
+    if (bands > height) bands = height;
+    int bandRows = (height + bands - 1) / bands;
+    bands = (height + bandRows - 1) / bandRows;
+
+    //Convert to 8 bit color.
+    std::vector<unsigned char> raw(rowBytes * height);
+    runParallel(threads, bands, [&](int band) {
+        int first = band * bandRows;
+        int last = std::min(first + bandRows, height);
+        floatToRGB8(&raw[first * rowBytes], pixels + first * rowBytes, (last - first) * rowBytes);
+    });
+
+    //Filter every row; each row only needs the row above it.
+    std::vector<unsigned char> filtered(filteredRow * height);
+    runParallel(threads, bands, [&](int band) {
+        int first = band * bandRows;
+        int last = std::min(first + bandRows, height);
+        for (int y = first; y < last; ++y) {
+            const unsigned char* prev = y > 0 ? &raw[(y - 1) * rowBytes] : NULL;
+            filterRow(&filtered[y * filteredRow], &raw[y * rowBytes], prev, rowBytes);
+        }
+    });
+
+    //Compress the bands, priming each with the tail of the band before it.
+    std::vector< std::vector<unsigned char> > streams(bands);
+    std::vector<unsigned long> checks(bands);
+    std::vector<char> ok(bands, 0);
+    runParallel(threads, bands, [&](int band) {
+        size_t start = band * bandRows * filteredRow;
+        size_t end = std::min((size_t)(band + 1) * bandRows, (size_t)height) * filteredRow;
+        size_t dictionaryLength = std::min(start, (size_t)DEFLATE_WINDOW);
+
+        ok[band] = deflateBand(&streams[band], &filtered[start], end - start,
+                               &filtered[start - dictionaryLength], dictionaryLength,
+                               level, band == bands - 1);
+        checks[band] = adler32(adler32(0L, Z_NULL, 0), &filtered[start], end - start);
+    });
+
+    for (int band = 0; band < bands; ++band) {
+        if (!ok[band]) return false;
+    }
+
+    FILE* fp = fopen(filename.c_str(), "wb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    fwrite(signature, 1, 8, fp);
+
+    //8 bit RGB, no interlacing.
+    unsigned char header[13];
+    putUint32(header, width);
+    putUint32(header + 4, height);
+    header[8] = 8;
+    header[9] = 2;
+    header[10] = 0;
+    header[11] = 0;
+    header[12] = 0;
+    writeChunk(fp, "IHDR", header, 13);
+
+    //zlib header, with the level hint that zlib itself would write.
+    int levelHint = level < 2 ? 0 : (level < 6 ? 1 : (level == 6 ? 2 : 3));
+    unsigned int zlibHeader = (0x78 << 8) | (levelHint << 6);
+    zlibHeader += 31 - (zlibHeader % 31);
+    unsigned char zlibStart[2] = { (unsigned char)(zlibHeader >> 8), (unsigned char)(zlibHeader & 0xff) };
+    writeChunk(fp, "IDAT", zlibStart, 2);
+
+    unsigned long check = checks[0];
+    for (int band = 0; band < bands; ++band) {
+        if (band > 0) {
+            size_t length = (std::min((size_t)(band + 1) * bandRows, (size_t)height) - (size_t)band * bandRows) * filteredRow;
+            check = adler32_combine(check, checks[band], length);
+        }
+        writeChunk(fp, "IDAT", &streams[band][0], streams[band].size());
+    }
+
+    unsigned char trailer[4];
+    putUint32(trailer, check);
+    writeChunk(fp, "IDAT", trailer, 4);
+    writeChunk(fp, "IEND", NULL, 0);
+
+    bool written = !ferror(fp);
+    fclose(fp);
+    return written;
+}
@@ -0,0 +1,49 @@
+//This file contains the ray statistics used by -raystats.
+
+#include <iostream>
+#include <chrono>
+#include <x86intrin.h>
+#include "ray_stats.h"
+
+thread_local RayStats rayStats = { 0, 0, 0 };
+bool rayStatsEnabled = false;
+
+//Time stamp counter ticks per nanosecond.
+static double ticksPerNanosecond = 1.0;
+
+void rayStatsInit()
+{
+    RayStats empty = { 0, 0, 0 };
+    rayStats = empty;
+
+    //Count the ticks over a few milliseconds of the steady clock.
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned long long startTicks = __rdtsc();
+    std::chrono::nanoseconds elapsed(0);
+    while (elapsed.count() < 20000000) {
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    ticksPerNanosecond = (double)(__rdtsc() - startTicks) / elapsed.count();
+
+    rayStatsEnabled = true;
+}
+
+void rayStatsCollect()
+{
+    rayStats.shadeNanoseconds += (long long)(rayStats.shadeCycles / ticksPerNanosecond);
+    rayStats.shadeCycles = 0;
+}
+
+void rayStatsAdd(RayStats* total, const RayStats* stats)
+{
+    total->primaryRays += stats->primaryRays;
+    total->shadeCycles += stats->shadeCycles;
+    total->shadeNanoseconds += stats->shadeNanoseconds;
+}
+
+void printRayStats(const RayStats* stats, long long pixels)
+{
+    double seconds = stats->shadeNanoseconds / 1e9;
+    std::cout << "Primary Rays: " << stats->primaryRays << " (" << (double)stats->primaryRays / pixels << " per pixel)" << std::endl;
+    std::cout << "Ray Rate: " << (seconds > 0.0 ? stats->primaryRays / seconds : 0.0) << " primary rays per second of shading" << std::endl;
+}
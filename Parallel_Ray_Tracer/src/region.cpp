@@ -0,0 +1,101 @@
+//This file contains the region of interest support.
+
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <png.h>
+#include "region.h"
+#include "options.h"
+#include "png_writer.h"
+
+RenderRegion renderRegion;
+
+bool regionInit(ConfigData* data)
+{
+    renderRegion.active = false;
+    if (runOptions.roiWidth <= 0) {
+        return false;
+    }
+
+    if (runOptions.roiX < 0 || runOptions.roiY < 0
+        || runOptions.roiX + runOptions.roiWidth > data->width
+        || runOptions.roiY + runOptions.roiHeight > data->height) {
+        std::cerr << "ERROR: -roi " << runOptions.roiX << "," << runOptions.roiY << ","
+                  << runOptions.roiWidth << "," << runOptions.roiHeight << " is not inside the "
+                  << data->width << " x " << data->height << " image" << std::endl;
+        return true;
+    }
+
+    renderRegion.active = true;
+    renderRegion.x = runOptions.roiX;
+    renderRegion.y = runOptions.roiY;
+    renderRegion.frame = *data;
+
+    data->width = runOptions.roiWidth;
+    data->height = runOptions.roiHeight;
+    return false;
+}
+
+bool loadRender(std::string file, int width, int height, float* image)
+{
+    png_image png;
+    memset(&png, 0, sizeof(png));
+    png.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&png, file.c_str())) {
+        std::cerr << "Could not read " << file << ": " << png.message << std::endl;
+        return false;
+    }
+    if ((int)png.width != width || (int)png.height != height) {
+        std::cerr << file << " is " << png.width << " x " << png.height << ", not "
+                  << width << " x " << height << std::endl;
+        png_image_free(&png);
+        return false;
+    }
+
+    png.format = PNG_FORMAT_RGB;
+    std::vector<unsigned char> bytes(PNG_IMAGE_SIZE(png));
+    if (!png_image_finish_read(&png, NULL, &bytes[0], 0, NULL)) {
+        std::cerr << "Could not read " << file << ": " << png.message << std::endl;
+        return false;
+    }
+
+    //Aim for the middle of each step so that saving gives back the same byte.
+    size_t values = 3 * (size_t)width * height;
+    for (size_t i = 0; i < values; ++i) {
+        image[i] = (bytes[i] + 0.5f) / 255.0f;
+    }
+    return true;
+}
+
+bool regionComposite(std::string base, const float* pixels, ConfigData* data, float* image)
+{
+    const ConfigData& frame = renderRegion.frame;
+    if (!loadRender(base, frame.width, frame.height, image)) {
+        return false;
+    }
+
+    for (int row = 0; row < data->height; ++row) {
+        memcpy(&image[3 * ((size_t)(row + renderRegion.y) * frame.width + renderRegion.x)],
+               &pixels[3 * (size_t)row * data->width], 3 * data->width * sizeof(float));
+    }
+    return true;
+}
+
+bool regionSavePng(std::string file, float* image, ConfigData* data)
+{
+    bool crop = renderRegion.active
+             && (data->width != renderRegion.frame.width || data->height != renderRegion.frame.height);
+    if (crop || runOptions.pngParallel) {
+        if (savePixelsParallel(file, image, data, runOptions.pngLevel, runOptions.pngThreads)) {
+            return true;
+        }
+        if (crop) {
+            std::cerr << "ERROR: the region could not be saved to " << file << std::endl;
+            return false;
+        }
+    }
+
+    //The engine's writer, unless the threaded one was asked for.
+    savePixels(file, image, data);
+    return true;
+}
@@ -4,15 +4,30 @@
 #include <mpi.h>
 #include <math.h>
 #include <queue>
+#include <vector>
 #include "RayTrace.h"
 #include "slave.h"
+#include "options.h"
+#include "mpi_output.h"
+#include "partition.h"
+#include "buffer_pool.h"
+#include "costmap.h"
+#include "trace.h"
+#include "antialias.h"
+#include "bands.h"
+#include "perf_counters.h"
+#include "ray_stats.h"
+#include "tile_codec.h"
+#include "batch.h"
 
 void slaveMain(ConfigData* data)
 {
     //Depending on the partitioning scheme, different things will happen.
     //You should have a different function for each of the required 
     //schemes that returns some values that you need to handle.
-    switch (data->partitioningMode)
+    perfPhase(PERF_COMM);
+    //PART_MODE_HYBRID is not one of the engine's PartType values.
+    switch ((int)data->partitioningMode)
     {
         case PART_MODE_NONE:
             //The slave will do nothing since this means sequential operation.
@@ -31,7 +46,11 @@ void slaveMain(ConfigData* data)
             break;
 
         case PART_MODE_DYNAMIC:
-            dynamicSlave(data);
+            dynamicSlave(data, 0);
+            break;
+
+        case PART_MODE_HYBRID:
+            hybridSlave(data);
             break;
 
         default:
@@ -39,51 +58,153 @@ void slaveMain(ConfigData* data)
             std::cout << ") is not currently implemented." << std::endl;
             break;
     }
+    perfPhase(PERF_OFF);
+
+    //Add this process's shading costs into the grid on the master.
+    if (!costMap.cost.empty()) {
+        MPI_Reduce(&costMap.cost[0], NULL, costMap.cost.size(), MPI_DOUBLE, MPI_SUM, 0, renderComm);
+    }
+
+    //And the anti-aliasing counts.
+    if (runOptions.aaThreshold > 0.0f) {
+        MPI_Reduce(&antialiasStats, NULL, 3, MPI_LONG_LONG, MPI_SUM, 0, renderComm);
+    }
+
+    //And the hardware counters.
+    if (runOptions.perf) {
+        MPI_Reduce(&perfStats, NULL, sizeof(perfStats) / sizeof(long long), MPI_LONG_LONG, MPI_SUM, 0, renderComm);
+    }
+
+    //And the ray counts.
+    if (runOptions.rayStats) {
+        rayStatsCollect();
+        MPI_Reduce(&rayStats, NULL, sizeof(rayStats) / sizeof(long long), MPI_LONG_LONG, MPI_SUM, 0, renderComm);
+    }
+
+    //And what the codec did.
+    if (runOptions.compress) {
+        MPI_Reduce(&codecStats, NULL, 4, MPI_LONG_LONG, MPI_SUM, 0, renderComm);
+    }
 }
 
-void dynamicSlave(ConfigData* data){
-    int blockUnit[4];
+void dynamicSlave(ConfigData* data, int firstCol){
+    UnitGrid grid = unitGrid(data, firstCol);
+    int unitIndex;
     MPI_Status status;
 
     while (true){
-        MPI_Send(NULL, 0, MPI_CHAR, 0, 1, MPI_COMM_WORLD);
+        double requestStart = traceNow();
+        MPI_Send(NULL, 0, MPI_CHAR, 0, 1, renderComm);
+        double requestEnd = traceNow();
+        traceEvent(TRACE_SEND, requestStart, requestEnd, 0);
 
         // get work unit!
-        MPI_Recv(blockUnit, 4, MPI_INT, 0, 2, MPI_COMM_WORLD, &status);
-
-        int startRow = blockUnit[0];
-        int startCol = blockUnit[1];
-        int blockHeight = blockUnit[3];
-        int blockWidth = blockUnit[2];
+        MPI_Recv(&unitIndex, 1, MPI_INT, 0, 2, renderComm, &status);
+        traceEvent(TRACE_RECV, requestEnd, traceNow(), 0);
 
-        if (blockWidth == 0 && blockHeight == 0){
+        if (unitIndex < 0){
+            // throw away cancels for units that were already sent back
+            if (runOptions.speculate) {
+                dynamicCancelled(-1);
+            }
             break; // sign to terminate program
         }
 
-        float* buffer = new float[3 * blockWidth * blockHeight + 1];
+        // the master only sends the index, the rectangle comes from the grid
+        WorkUnit unit = unitAt(&grid, unitIndex);
+        int startRow = unit.startRow;
+        int startCol = unit.startCol;
+        int blockHeight = unit.blockHeight;
+        int blockWidth = unit.blockWidth;
+        int unitId = unit.id;
+
+        float* buffer = poolAcquire(3 * blockWidth * blockHeight + 1);
 
         double startTime = MPI_Wtime();
+        perfPhase(PERF_SHADE);
+        bool cancelled = false;
 
-        for (int i = 0; i < blockHeight; ++i) {
+        for (int i = 0; i < blockHeight && !cancelled; ++i) {
             for (int j = 0; j < blockWidth; ++j) {
                 int row = startRow + i;
                 int col = startCol + j;
                 int idx = 3 * (i * blockWidth + j);
-                shadePixel(&buffer[idx], row, col, data);
+                shadePixelCosted(&buffer[idx], row, col, data);
             }
+            // another copy of this unit may have finished first
+            if (runOptions.speculate) {
+                cancelled = dynamicCancelled(unitId);
+            }
+        }
+
+        if (cancelled) {
+            perfPhase(PERF_COMM);
+            traceEvent(TRACE_SHADE, startTime, traceNow());
+            poolRelease(buffer);
+            continue;
         }
+        antialiasTile(buffer, 3 * blockWidth, startRow, startCol, blockHeight, blockWidth, data);
 
         double endTime = MPI_Wtime();
+        perfPhase(PERF_COMM);
+        traceEvent(TRACE_SHADE, startTime, endTime);
         double computationTime = endTime - startTime;
         buffer[blockWidth * blockHeight * 3] = computationTime;
 
         // Send result back to master
-        MPI_Send(buffer, 3 * blockWidth * blockHeight + 1, MPI_FLOAT, 0, 3, MPI_COMM_WORLD);
+        double sendStart = traceNow();
+        sendTile(buffer, 3 * blockWidth * blockHeight + 1, 0, 3);
+        traceEvent(TRACE_SEND, sendStart, traceNow(), 0);
 
-        delete[] buffer;
+        poolRelease(buffer);
     }
 }
 
+void hybridSlave(ConfigData* data){
+    int firstCol, lastCol;
+    int staticCols = hybridStripColumns(data, data->mpi_rank, &firstCol, &lastCol);
+    int numCols = lastCol - firstCol + 1;
+    float* pixelColumns = poolAcquire(3 * data->height * numCols + 1);
+
+    double computationStart = MPI_Wtime();
+    perfPhase(PERF_SHADE);
+
+    for (int i = 0; i < data->height; ++i) {
+        for (int j = firstCol; j <= lastCol; ++j) {
+            int baseIndex = 3 * (i * numCols + (j - firstCol));
+            shadePixelCosted(&(pixelColumns[baseIndex]), i, j, data);
+        }
+    }
+    antialiasTile(pixelColumns, 3 * numCols, 0, firstCol, data->height, numCols, data);
+
+    double computationStop = MPI_Wtime();
+    perfPhase(PERF_COMM);
+    traceEvent(TRACE_SHADE, computationStart, computationStop);
+    pixelColumns[3 * data->height * numCols] = computationStop - computationStart;
+    sendTile(pixelColumns, (3 * data->height * numCols) + 1, 0, 100);
+    traceEvent(TRACE_SEND, computationStop, traceNow(), 0);
+    poolRelease(pixelColumns);
+
+    // the rest of the image is shared out like the dynamic mode
+    dynamicSlave(data, staticCols);
+}
+
+bool dynamicCancelled(int unitId){
+    bool cancelled = false;
+    int flag = 0;
+
+    MPI_Iprobe(0, 4, renderComm, &flag, MPI_STATUS_IGNORE);
+    while (flag) {
+        int id;
+        MPI_Recv(&id, 1, MPI_INT, 0, 4, renderComm, MPI_STATUS_IGNORE);
+        if (id == unitId) {
+            cancelled = true;
+        }
+        MPI_Iprobe(0, 4, renderComm, &flag, MPI_STATUS_IGNORE);
+    }
+    return cancelled;
+}
+
 
 // void staticStripsHorizontalSlave(ConfigData* data){
 
@@ -132,119 +253,116 @@ void dynamicSlave(ConfigData* data){
 
 void staticStripsVerticalSlave(ConfigData* data){
 
-    // dividing by columns
-    int cols = data->width / data->mpi_procs;  // divide height into strips
-    int extra = data->width % data->mpi_procs; // extra columns for some processes
-    int firstCol = data->mpi_rank * cols;
-    int lastCol = firstCol + cols - 1;
-
-    // // give last rank the extra data to compute
-    if (data -> mpi_rank == data -> mpi_procs -1 ){
-        lastCol += extra; 
-    }
-    std::cout << "Rank " << data->mpi_rank << " processes columns from " << firstCol << " to " << lastCol << std::endl;
+    // dividing by columns, sized by speed with -weighted
+    int firstCol, lastCol;
+    stripColumns(data, data->mpi_rank, &firstCol, &lastCol);
 
     // only need to allocate the memroy for the processe's portion
     int numCols = lastCol - firstCol + 1;
-    float* pixelColumns = new float[3 * data->height * numCols];
+    float* pixelColumns = poolAcquire(3 * data->height * numCols + 1);
     
-    double computationStart = MPI_Wtime();
-
-    for (int j = firstCol; j <= lastCol; ++j) {
-        for (int i = 0; i < data->height; ++i) {
-            int baseIndex = 3 * (i * numCols + (j - firstCol));
-            shadePixel(&(pixelColumns[baseIndex]), i, j, data);
+    double computationTime = 0.0;
+    BandSender sender;
+    AntialiasCarry carry;
+    int bands = bandCount(data->height);
+
+    for (int band = 0; band < bands; ++band) {
+        int first, count;
+        bandRows(data->height, band, &first, &count);
+        int shadeFirst = first, shadeCount = count;
+        antialiasBandRows(data->height, &shadeFirst, &shadeCount);
+
+        double computationStart = MPI_Wtime();
+        perfPhase(PERF_SHADE);
+        for (int i = shadeFirst; i < shadeFirst + shadeCount; ++i) {
+            for (int j = firstCol; j <= lastCol; ++j) {
+                int baseIndex = 3 * (i * numCols + (j - firstCol));
+                shadePixelCosted(&(pixelColumns[baseIndex]), i, j, data);
+            }
+        }
+        antialiasBand(pixelColumns + 3 * numCols * first, 3 * numCols, first, firstCol, count, numCols,
+                      first + count < data->height, &carry, data);
+        double computationStop = MPI_Wtime();
+        perfPhase(PERF_COMM);
+        computationTime += computationStop - computationStart;
+        traceEvent(TRACE_SHADE, computationStart, computationStop);
+
+        // send the band while the next one is rendered; the last band carries the time
+        if (!writesOwnRegion(data)) {
+            pixelColumns[3 * data->height * numCols] = computationTime;
+            sendBand(pixelColumns, 3 * numCols, data->height, band, &sender);
         }
     }
 
-    // Stop the computation timer
-    double computationStop = MPI_Wtime();
-    double computationTime = computationStop - computationStart;
-    pixelColumns[3 * data->height * numCols] = computationTime;
-    // count = 3(RGB) * data->height (number of rows) * numCols (nuber of cols in this process)
-    MPI_Send(pixelColumns, (3 * data->height * numCols) + 1, MPI_FLOAT, 0, 100, MPI_COMM_WORLD);
-    delete[] pixelColumns;
-}
-
-void staticSquareBlocksSlave(ConfigData* data){
-
-    // dividing into square blocks
-    int square = 0;
-    int root = (int) sqrt(data->mpi_procs);
-    float test = (float)data->mpi_procs / (float)root;
-    if(test != root){
-        square = ((int)sqrt(data->mpi_procs) + 1) * ((int)sqrt(data->mpi_procs) + 1);
-    }else{
-        square = data->mpi_procs;
-    }
-
-    int size = (data->width)*(data->height) / square;  // divide total number of elements into sqaures
-    int dim = sqrt(size);
-
-    int max = data->width / dim;
-    int hOffset = (data->width - (dim * max));
-    if(hOffset > 1){
-        hOffset /= 2;
+    if (writesOwnRegion(data)) {
+        //Write the strip straight into the output file instead.
+        writeOwnRegion(data, rowRange(0, data->height - 1), firstCol, numCols, pixelColumns, 3 * numCols, computationTime);
     }
-    int vOffset = (data->height - (dim * max));
-    if(vOffset > 1){
-        vOffset /= 2;
+    else {
+        finishBandSends(&sender);
     }
+    poolRelease(pixelColumns);
+}
 
-    int firstCol = (data->mpi_rank % max) * dim + hOffset;
-    int lastCol = firstCol + dim - 1;
-    int firstRow = (data->mpi_rank / max) * dim + vOffset;
-    int lastRow = firstRow + dim - 1;
+void staticSquareBlocksSlave(ConfigData* data){
 
-    // extend processes with edge squares to cover entire scene
-    if (firstCol == hOffset){
-        firstCol = 0;
-    }
-    if (lastCol == dim * max + hOffset){
-        lastCol = data->width - 1;
-    }
-    if (firstRow == vOffset){
-        firstRow = 0;
-    }
-    if (lastRow == dim * max + vOffset || (data->mpi_procs - data->mpi_rank - 1) < max){
-        lastRow = data->height - 1;
-    }
-    std::cout << "Rank " << data->mpi_rank << " processes data in square [" << firstCol << ", " << firstRow << "] to ["
-            << lastCol << ", " << lastRow << "]" << std::endl;
+    // dividing into square blocks, or blocks sized by speed with -weighted
+    int firstRow, lastRow, firstCol, lastCol;
+    blockBounds(data, data->mpi_rank, &firstRow, &lastRow, &firstCol, &lastCol);
 
     // only need to allocate the memory for the process's portion
     int sizeP = (3 * (lastRow - firstRow + 1) * (lastCol - firstCol + 1)) + 1;
-    float* pixelSquares = new float[sizeP];
+    float* pixelSquares = poolAcquire(sizeP);
     
-    double computationStart = MPI_Wtime();
-
-    for (int i = 0; i < (lastRow - firstRow + 1); i++) {
-        for (int j = 0; j < (lastCol - firstCol + 1); j++) {
-            int baseIndex = 3 * (i * (lastCol - firstCol + 1) + j);
-            int x = i + firstRow;
-            int y = j + firstCol;
-            if(x < (data->width - 1) && y < (data->height - 1) && baseIndex < sizeP){
-                shadePixel(&(pixelSquares[baseIndex]), x, y, data);
+    int numRows = lastRow - firstRow + 1;
+    int numCols = lastCol - firstCol + 1;
+    double computationTime = 0.0;
+    BandSender sender;
+    AntialiasCarry carry;
+    int bands = bandCount(numRows);
+
+    for (int band = 0; band < bands; ++band) {
+        int first, count;
+        bandRows(numRows, band, &first, &count);
+        int shadeFirst = first, shadeCount = count;
+        antialiasBandRows(numRows, &shadeFirst, &shadeCount);
+
+        double computationStart = MPI_Wtime();
+        perfPhase(PERF_SHADE);
+        for (int i = shadeFirst; i < shadeFirst + shadeCount; i++) {
+            for (int j = 0; j < numCols; j++) {
+                int baseIndex = 3 * (i * numCols + j);
+                int x = i + firstRow;
+                int y = j + firstCol;
+                if(x < (data->width - 1) && y < (data->height - 1) && baseIndex < sizeP){
+                    shadePixelCosted(&(pixelSquares[baseIndex]), x, y, data);
+                }
             }
         }
+        antialiasBand(pixelSquares + 3 * numCols * first, 3 * numCols, firstRow + first, firstCol, count, numCols,
+                      first + count < numRows, &carry, data);
+        double computationStop = MPI_Wtime();
+        perfPhase(PERF_COMM);
+        computationTime += computationStop - computationStart;
+        traceEvent(TRACE_SHADE, computationStart, computationStop);
+
+        // send the band while the next one is rendered; the last band carries the time
+        if (!writesOwnRegion(data)) {
+            pixelSquares[3 * numRows * numCols] = computationTime;
+            sendBand(pixelSquares, 3 * numCols, numRows, band, &sender);
+        }
     }
 
-    // Stop the computation timer
-    double computationStop = MPI_Wtime();
-    double computationTime = computationStop - computationStart;
-    pixelSquares[3 * (lastRow - firstRow + 1) * (lastCol - firstCol + 1)] = computationTime;
-
-    // In staticSquareBlocksSlave, before MPI_Send:
-    std::cout << "Slave " << data->mpi_rank << ": Sending data in square [" << firstCol << ", " << firstRow << "] to ["
-            << lastCol << ", " << lastRow << "]" << std::endl;
-    std::cout << "Slave " << data->mpi_rank << ": First few values: " << pixelSquares[0] << ", " << pixelSquares[3] << ", " << pixelSquares[6] << std::endl;
-    // count = 3(RGB) * data->height (number of rows) * numCols (nuber of cols in this process)
-    MPI_Send(pixelSquares, (3 * (lastRow - firstRow + 1) * (lastCol - firstCol + 1)) + 1, MPI_FLOAT, 0, 100, MPI_COMM_WORLD);
-  
-
-    std::cout << "Slave " << data->mpi_rank << " Computation Time: " << computationTime << " seconds" << std::endl;
+    if (writesOwnRegion(data)) {
+        //Write the square straight into the output file instead.
+        writeOwnRegion(data, rowRange(firstRow, lastRow), firstCol, numCols,
+                       pixelSquares, 3 * numCols, computationTime);
+    }
+    else {
+        finishBandSends(&sender);
+    }
 
-    delete[] pixelSquares;
+    poolRelease(pixelSquares);
 }
 
 
@@ -265,30 +383,52 @@ void slaveStaticCyclesHorizontal(ConfigData* data) {
         }
     }
 
-    std::cout << "Rank " << data->mpi_rank << " processes rows: ";
-    for (int r : ownedRows) std::cout << r << " ";
-    std::cout << std::endl;
-
     // Only need to allocate memory for the process's rows across full width
     int numRows = ownedRows.size();
-    float* pixelRows = new float[3 * data->width * numRows + 1];
-
-    double computationStart = MPI_Wtime();
-
-    for (int idx = 0; idx < numRows; ++idx) {
-        int i = ownedRows[idx];
-        for (int j = 0; j < data->width; ++j) {
-            int baseIndex = 3 * (idx * data->width + j);
-            shadePixel(&(pixelRows[baseIndex]), i, j, data);
+    float* pixelRows = poolAcquire(3 * data->width * numRows + 1);
+
+    double computationTime = 0.0;
+    BandSender sender;
+    AntialiasCarry carry;
+    int bands = bandCount(numRows);
+
+    for (int band = 0; band < bands; ++band) {
+        int first, count;
+        bandRows(numRows, band, &first, &count);
+        int shadeFirst = first, shadeCount = count;
+        antialiasBandRows(numRows, &shadeFirst, &shadeCount);
+
+        double computationStart = MPI_Wtime();
+        perfPhase(PERF_SHADE);
+        for (int idx = shadeFirst; idx < shadeFirst + shadeCount; ++idx) {
+            int i = ownedRows[idx];
+            for (int j = 0; j < data->width; ++j) {
+                int baseIndex = 3 * (idx * data->width + j);
+                shadePixelCosted(&(pixelRows[baseIndex]), i, j, data);
+            }
+        }
+        antialiasRows(pixelRows + 3 * data->width * first,
+                      std::vector<int>(ownedRows.begin() + first, ownedRows.begin() + first + count),
+                      first + count < numRows ? ownedRows[first + count] : -1, &carry, data);
+        double computationStop = MPI_Wtime();
+        perfPhase(PERF_COMM);
+        computationTime += computationStop - computationStart;
+        traceEvent(TRACE_SHADE, computationStart, computationStop);
+
+        // send the band while the next one is rendered; the last band carries the time
+        if (!writesOwnRegion(data)) {
+            pixelRows[3 * data->width * numRows] = computationTime;
+            sendBand(pixelRows, 3 * data->width, numRows, band, &sender);
         }
     }
 
-    double computationStop = MPI_Wtime();
-    double computationTime = computationStop - computationStart;
-    pixelRows[3 * data->width * numRows] = computationTime;
-
-    // count = 3(RGB) * data->width * numRows + 1 for time
-    MPI_Send(pixelRows, (3 * data->width * numRows) + 1, MPI_FLOAT, 0, 100, MPI_COMM_WORLD);
+    if (writesOwnRegion(data)) {
+        //Write the rows straight into the output file instead.
+        writeOwnRegion(data, ownedRows, 0, data->width, pixelRows, 3 * data->width, computationTime);
+    }
+    else {
+        finishBandSends(&sender);
+    }
 
-    delete[] pixelRows;
+    poolRelease(pixelRows);
 }
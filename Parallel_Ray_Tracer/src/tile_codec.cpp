@@ -0,0 +1,195 @@
+//This file contains the lossless codec used by -compress.
+
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include "tile_codec.h"
+#include "options.h"
+#include "buffer_pool.h"
+#include "batch.h"
+
+CodecStats codecStats = { 0, 0, 0, 0 };
+
+//Run-length encode bytes into out. Gives up and returns -1 once the
+//output would be longer than capacity.
+static int packBits(const unsigned char* in, int length, unsigned char* out, int capacity)
+{
+    int written = 0;
+    int i = 0;
+    while (i < length) {
+        //A run of at least three bytes is worth a control byte.
+        int run = 1;
+        while (i + run < length && run < 130 && in[i + run] == in[i]) {
+            ++run;
+        }
+        if (run >= 3) {
+            if (written + 2 > capacity) return -1;
+            out[written++] = (unsigned char)(run + 125);
+            out[written++] = in[i];
+            i += run;
+            continue;
+        }
+
+        //Otherwise copy literals up to the next run.
+        int literals = 0;
+        while (i + literals < length && literals < 128) {
+            if (i + literals + 2 < length && in[i + literals] == in[i + literals + 1]
+                && in[i + literals] == in[i + literals + 2]) {
+                break;
+            }
+            ++literals;
+        }
+        if (written + 1 + literals > capacity) return -1;
+        out[written++] = (unsigned char)(literals - 1);
+        memcpy(&out[written], &in[i], literals);
+        written += literals;
+        i += literals;
+    }
+    return written;
+}
+
+static bool unpackBits(const unsigned char* in, int length, unsigned char* out, int expected)
+{
+    int read = 0;
+    int written = 0;
+    while (read < length) {
+        int control = in[read++];
+        if (control < 128) {
+            int literals = control + 1;
+            if (read + literals > length || written + literals > expected) return false;
+            memcpy(&out[written], &in[read], literals);
+            read += literals;
+            written += literals;
+        }
+        else {
+            int run = control - 125;
+            if (read >= length || written + run > expected) return false;
+            memset(&out[written], in[read++], run);
+            written += run;
+        }
+    }
+    return written == expected;
+}
+
+int tilePackedCapacity(int count)
+{
+    return sizeof(TileHeader) + count * sizeof(float);
+}
+
+int tilePack(const float* values, int count, unsigned char* message)
+{
+    double start = MPI_Wtime();
+    TileHeader header;
+    header.rawBytes = count * sizeof(float);
+
+    //Take the difference from the same channel of the previous pixel and
+    //split the bytes into planes.
+    static std::vector<unsigned char> planes;
+    planes.resize(header.rawBytes);
+    const unsigned int* bits = (const unsigned int*)values;
+    for (int i = 0; i < count; ++i) {
+        unsigned int delta = bits[i] - (i >= 3 ? bits[i - 3] : 0);
+        for (int b = 0; b < 4; ++b) {
+            planes[b * count + i] = (unsigned char)(delta >> (8 * b));
+        }
+    }
+
+    unsigned char* payload = message + sizeof(TileHeader);
+    header.codec = CODEC_SHUFFLE_RLE;
+    header.packedBytes = packBits(&planes[0], header.rawBytes, payload, header.rawBytes);
+    if (header.packedBytes < 0) {
+        header.codec = CODEC_NONE;
+        header.packedBytes = header.rawBytes;
+        memcpy(payload, values, header.rawBytes);
+    }
+    memcpy(message, &header, sizeof(header));
+
+    codecStats.rawBytes += header.rawBytes;
+    codecStats.packedBytes += sizeof(TileHeader) + header.packedBytes;
+    codecStats.encodeNanoseconds += (long long)((MPI_Wtime() - start) * 1e9);
+    return sizeof(TileHeader) + header.packedBytes;
+}
+
+bool tileUnpack(const unsigned char* message, int bytes, float* values, int count)
+{
+    double start = MPI_Wtime();
+    TileHeader header;
+    if (bytes < (int)sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, message, sizeof(header));
+    if (header.rawBytes != count * (int)sizeof(float) || header.packedBytes != bytes - (int)sizeof(header)) {
+        return false;
+    }
+
+    const unsigned char* payload = message + sizeof(TileHeader);
+    if (header.codec == CODEC_NONE) {
+        memcpy(values, payload, header.rawBytes);
+    }
+    else if (header.codec == CODEC_SHUFFLE_RLE) {
+        static std::vector<unsigned char> planes;
+        planes.resize(header.rawBytes);
+        if (!unpackBits(payload, header.packedBytes, &planes[0], header.rawBytes)) {
+            return false;
+        }
+
+        //Put the planes back together and undo the differences.
+        unsigned int* bits = (unsigned int*)values;
+        for (int i = 0; i < count; ++i) {
+            unsigned int delta = 0;
+            for (int b = 0; b < 4; ++b) {
+                delta |= (unsigned int)planes[b * count + i] << (8 * b);
+            }
+            bits[i] = delta + (i >= 3 ? bits[i - 3] : 0);
+        }
+    }
+    else {
+        return false;
+    }
+
+    codecStats.decodeNanoseconds += (long long)((MPI_Wtime() - start) * 1e9);
+    return true;
+}
+
+void sendTile(const float* values, int count, int dest, int tag)
+{
+    if (!runOptions.compress) {
+        MPI_Send(values, count, MPI_FLOAT, dest, tag, renderComm);
+        return;
+    }
+
+    int capacity = tilePackedCapacity(count);
+    unsigned char* message = (unsigned char*)poolAcquire((capacity + sizeof(float) - 1) / sizeof(float));
+    int bytes = tilePack(values, count, message);
+    MPI_Send(message, bytes, MPI_BYTE, dest, tag, renderComm);
+    poolRelease((float*)message);
+}
+
+void recvTile(float* values, int count, int source, int tag)
+{
+    if (!runOptions.compress) {
+        MPI_Recv(values, count, MPI_FLOAT, source, tag, renderComm, MPI_STATUS_IGNORE);
+        return;
+    }
+
+    MPI_Status status;
+    int bytes;
+    MPI_Probe(source, tag, renderComm, &status);
+    MPI_Get_count(&status, MPI_BYTE, &bytes);
+    unsigned char* message = (unsigned char*)poolAcquire((bytes + sizeof(float) - 1) / sizeof(float));
+    MPI_Recv(message, bytes, MPI_BYTE, source, tag, renderComm, MPI_STATUS_IGNORE);
+    if (!tileUnpack(message, bytes, values, count)) {
+        std::cerr << "ERROR: a compressed tile from rank " << source << " could not be decoded" << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    poolRelease((float*)message);
+}
+
+void printCodecStats(const CodecStats* stats)
+{
+    double ratio = stats->packedBytes > 0 ? (double)stats->rawBytes / stats->packedBytes : 0.0;
+    std::cout << "Compression Ratio: " << ratio << " (" << stats->packedBytes << " bytes sent for "
+              << stats->rawBytes << ")" << std::endl;
+    std::cout << "Compression Time: " << stats->encodeNanoseconds / 1e9 << " seconds encoding, "
+              << stats->decodeNanoseconds / 1e9 << " seconds decoding" << std::endl;
+}
@@ -0,0 +1,155 @@
+//This file contains the threaded renderer used by raytrace_seq -t.
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "tile_render.h"
+#include "costmap.h"
+#include "antialias.h"
+#include "ray_stats.h"
+#include "options.h"
+
+static_assert(std::atomic<int>::is_always_lock_free, "the tile counter must be lock-free");
+
+//Find the pixels of one tile.
+static void tileBounds(ConfigData* data, int tile, int tilesAcross, int* firstRow, int* firstCol, int* numRows, int* numCols)
+{
+    *firstRow = (tile / tilesAcross) * RENDER_TILE_SIZE;
+    *firstCol = (tile % tilesAcross) * RENDER_TILE_SIZE;
+    *numRows = std::min(RENDER_TILE_SIZE, data->height - *firstRow);
+    *numCols = std::min(RENDER_TILE_SIZE, data->width - *firstCol);
+}
+
+//Render one tile in place.
+static void renderTile(float* pixels, ConfigData* data, int tile, int tilesAcross)
+{
+    int firstRow, firstCol, numRows, numCols;
+    tileBounds(data, tile, tilesAcross, &firstRow, &firstCol, &numRows, &numCols);
+
+    for (int i = firstRow; i < firstRow + numRows; ++i) {
+        for (int j = firstCol; j < firstCol + numCols; ++j) {
+            shadePixelCosted(&(pixels[3 * (i * data->width + j)]), i, j, data);
+        }
+    }
+}
+
+void renderTiles(float* pixels, ConfigData* data, int threads)
+{
+    int tilesAcross = (data->width + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE;
+    int tilesDown = (data->height + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE;
+    int tiles = tilesAcross * tilesDown;
+
+    //With -aa every tile is shaded before any is anti-aliased, so that the
+    //pixels around a tile are read from a copy of the image instead of
+    //being shaded again. The last thread to finish shading takes the copy.
+    bool antialias = runOptions.aaThreshold > 0.0f;
+    std::vector<float> unrefined;
+    std::atomic<int> next(0);
+    std::atomic<int> nextRefine(0);
+    std::atomic<int> shading(threads);
+    std::atomic<bool> copied(false);
+    auto worker = [&]() {
+        for (int tile = next.fetch_add(1, std::memory_order_relaxed); tile < tiles;
+             tile = next.fetch_add(1, std::memory_order_relaxed)) {
+            renderTile(pixels, data, tile, tilesAcross);
+        }
+        if (!antialias) {
+            return;
+        }
+
+        if (shading.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            unrefined.assign(pixels, pixels + 3 * (size_t)data->width * data->height);
+            copied.store(true, std::memory_order_release);
+        }
+        while (!copied.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        for (int tile = nextRefine.fetch_add(1, std::memory_order_relaxed); tile < tiles;
+             tile = nextRefine.fetch_add(1, std::memory_order_relaxed)) {
+            int firstRow, firstCol, numRows, numCols;
+            tileBounds(data, tile, tilesAcross, &firstRow, &firstCol, &numRows, &numCols);
+            antialiasImageTile(pixels, &unrefined[0], firstRow, firstCol, numRows, numCols, data);
+        }
+    };
+
+    //The other threads start with an empty grid of the same shape and
+    //leave what they measured here, to be added in once they are done.
+    std::vector<CostMap> costMaps(threads);
+    std::vector<AntialiasStats> stats(threads);
+    std::vector<RayStats> rays(threads);
+    CostMap emptyCostMap = costMap;
+    std::fill(emptyCostMap.cost.begin(), emptyCostMap.cost.end(), 0.0);
+    auto helper = [&](int t) {
+        costMap = emptyCostMap;
+        worker();
+        costMaps[t].cost.swap(costMap.cost);
+        stats[t] = antialiasStats;
+        if (rayStatsEnabled) {
+            rayStatsCollect();
+            rays[t] = rayStats;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) {
+        pool.push_back(std::thread(helper, t));
+    }
+    worker();
+    for (size_t t = 0; t < pool.size(); ++t) {
+        pool[t].join();
+    }
+
+    for (int t = 1; t < threads; ++t) {
+        for (size_t c = 0; c < costMaps[t].cost.size(); ++c) {
+            costMap.cost[c] += costMaps[t].cost[c];
+        }
+        antialiasStats.pixels += stats[t].pixels;
+        antialiasStats.refined += stats[t].refined;
+        antialiasStats.extraSamples += stats[t].extraSamples;
+        rayStatsAdd(&rayStats, &rays[t]);
+    }
+}
+
+void renderImage(float* pixels, ConfigData* data)
+{
+    for (int row = 0; row < data->height; ++row) {
+        for (int column = 0; column < data->width; ++column) {
+            shadePixelCosted(&pixels[3 * ((size_t)row * data->width + column)], row, column, data);
+        }
+    }
+    antialiasTile(pixels, 3 * data->width, 0, 0, data->height, data->width, data);
+}
+
+long long checkTiles(const float* pixels, ConfigData* data, int threads, int runs)
+{
+    //The extra renders must not show up in what was measured.
+    CostMap savedCostMap = costMap;
+    AntialiasStats savedAntialias = antialiasStats;
+    RayStats savedRays = rayStats;
+
+    size_t count = 3 * (size_t)data->width * data->height;
+    std::vector<float> reference(count);
+    std::vector<float> threaded(count);
+    renderImage(&reference[0], data);
+
+    long long differing = 0;
+    for (int run = 0; run < runs; ++run) {
+        const float* image = pixels;
+        if (run > 0) {
+            renderTiles(&threaded[0], data, threads);
+            image = &threaded[0];
+        }
+        for (size_t p = 0; p < count; p += 3) {
+            if (memcmp(&reference[p], &image[p], 3 * sizeof(float)) != 0) {
+                differing++;
+            }
+        }
+    }
+
+    costMap = savedCostMap;
+    antialiasStats = savedAntialias;
+    rayStats = savedRays;
+    return differing;
+}
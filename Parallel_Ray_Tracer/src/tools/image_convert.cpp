@@ -0,0 +1,101 @@
+//This tool converts the images written with -out raw, pfm or ppm into a PNG,
+//using the same color conversion as the ray tracer.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "png_writer.h"
+
+//Read the width and height from a PFM or PPM header and leave the stream
+//at the first byte of pixel data.
+bool readHeader(std::ifstream& in, std::string* magic, int* width, int* height)
+{
+    std::string scale;
+    in >> *magic >> *width >> *height >> scale;
+    in.get();
+    return in.good() && *width > 0 && *height > 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3 && argc != 5)
+    {
+        std::cerr << "Usage: " << argv[0] << " input.(raw|pfm|ppm) output.png [width height]" << std::endl;
+        std::cerr << "    width and height are only needed for raw input." << std::endl;
+        return 1;
+    }
+
+    std::string input = argv[1];
+    std::string extension = input.substr(input.find_last_of('.') + 1);
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in)
+    {
+        std::cerr << "The file (" << input << ") could not be opened." << std::endl;
+        return 1;
+    }
+
+    ConfigData data;
+    std::string magic;
+    if (extension == "raw")
+    {
+        if (argc != 5)
+        {
+            std::cerr << "ERROR: raw input needs the width and height." << std::endl;
+            return 1;
+        }
+        data.width = atoi(argv[3]);
+        data.height = atoi(argv[4]);
+    }
+    else if (!readHeader(in, &magic, &data.width, &data.height) || (magic != "PF" && magic != "P6"))
+    {
+        std::cerr << "The file (" << input << ") does not appear to be pfm or ppm." << std::endl;
+        return 1;
+    }
+
+    size_t values = 3 * (size_t)data.width * data.height;
+    std::vector<float> pixels(values);
+
+    if (magic == "P6")
+    {
+        std::vector<unsigned char> bytes(values);
+        in.read((char*)&bytes[0], values);
+        //Aim for the middle of each step so that the truncation in the
+        //PNG writer gives back the same byte.
+        for (size_t i = 0; i < values; ++i)
+        {
+            pixels[i] = (bytes[i] + 0.5f) / 255.0f;
+        }
+    }
+    else
+    {
+        in.read((char*)&pixels[0], values * sizeof(float));
+    }
+
+    if (!in)
+    {
+        std::cerr << "The file (" << input << ") is shorter than " << data.width << " x " << data.height << "." << std::endl;
+        return 1;
+    }
+
+    //PFM is stored bottom row first.
+    if (magic == "PF")
+    {
+        size_t rowValues = 3 * (size_t)data.width;
+        for (int row = 0; row < data.height / 2; ++row)
+        {
+            std::swap_ranges(pixels.begin() + row * rowValues, pixels.begin() + (row + 1) * rowValues,
+                             pixels.begin() + (data.height - 1 - row) * rowValues);
+        }
+    }
+
+    if (!savePixelsParallel(argv[2], &pixels[0], &data, 6, 0))
+    {
+        std::cerr << "Could not write " << argv[2] << std::endl;
+        return 1;
+    }
+    return 0;
+}
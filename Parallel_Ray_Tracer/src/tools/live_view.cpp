@@ -0,0 +1,177 @@
+//This tool receives the tiles that raytrace_mpi streams with -live and
+//puts the image together while it is rendered. Every second, and when a
+//frame is finished, the picture so far is written to a PNG, so it can be
+//left open in an image viewer that reloads the file.
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "live_stream.h"
+#include "png_writer.h"
+
+//The image of the current frame and which of its pixels have arrived.
+struct Frame
+{
+    ConfigData data;
+    std::vector<float> pixels;
+    std::vector<char> received;
+    long long receivedCount;
+};
+
+void startFrame(Frame* frame, int width, int height)
+{
+    frame->data.width = width;
+    frame->data.height = height;
+    frame->pixels.assign(3 * (size_t)width * height, 0.0f);
+    frame->received.assign((size_t)width * height, 0);
+    frame->receivedCount = 0;
+}
+
+//Copy the RGB triples of a tile into the frame.
+bool pasteTile(Frame* frame, const LiveHeader& header, const unsigned char* rgb, int bytes)
+{
+    if (header.x < 0 || header.y < 0 || header.width <= 0 || header.height <= 0
+        || header.x + header.width > frame->data.width || header.y + header.height > frame->data.height
+        || bytes != 3 * header.width * header.height) {
+        return false;
+    }
+    for (int i = 0; i < header.height; ++i) {
+        for (int j = 0; j < header.width; ++j) {
+            size_t pixel = (size_t)(header.y + i) * frame->data.width + header.x + j;
+            const unsigned char* in = rgb + 3 * (i * header.width + j);
+            //Aim for the middle of each step so that the truncation in the
+            //PNG writer gives back the same byte.
+            for (int c = 0; c < 3; ++c) {
+                frame->pixels[3 * pixel + c] = (in[c] + 0.5f) / 255.0f;
+            }
+            if (!frame->received[pixel]) {
+                frame->received[pixel] = 1;
+                frame->receivedCount++;
+            }
+        }
+    }
+    return true;
+}
+
+void saveFrame(Frame* frame, const std::string& file, int number)
+{
+    if (frame->pixels.empty()) {
+        return;
+    }
+    savePixelsParallel(file, &frame->pixels[0], &frame->data, 1, 1);
+    double percent = 100.0 * frame->receivedCount / ((double)frame->data.width * frame->data.height);
+    std::cout << "Frame " << number << " (" << frame->data.width << " x " << frame->data.height << "): "
+              << percent << "% of the pixels -> " << file << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3 && argc != 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " socket output.png [frames]" << std::endl;
+        std::cerr << "    Listens on socket for raytrace_mpi -live socket, and stops after" << std::endl;
+        std::cerr << "    frames images (default 1; 0 keeps going). With more than one" << std::endl;
+        std::cerr << "    frame, the number of the frame is added to the file name." << std::endl;
+        return 1;
+    }
+    std::string path = argv[1];
+    std::string output = argv[2];
+    int frames = argc == 4 ? atoi(argv[3]) : 1;
+
+    struct sockaddr_un address;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "The socket path (" << path << ") is too long." << std::endl;
+        return 1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    unlink(path.c_str());
+    if (fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        std::cerr << "Could not listen on " << path << std::endl;
+        return 1;
+    }
+    //A deep queue lets the viewer fall behind for a while before tiles are dropped.
+    int queueBytes = 8 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &queueBytes, sizeof(queueBytes));
+    std::cout << "Listening on " << path << std::endl;
+
+    Frame frame;
+    frame.data.width = frame.data.height = 0;
+    int number = 1;
+    bool changed = false;
+    time_t lastSave = time(NULL);
+    std::vector<unsigned char> message(LIVE_MAX_DATAGRAM);
+    while (frames == 0 || number <= frames)
+    {
+        std::string file = output;
+        if (frames != 1)
+        {
+            std::ostringstream name;
+            name << output.substr(0, output.find_last_of('.')) << "_" << number << ".png";
+            file = name.str();
+        }
+
+        //Show what there is once a second.
+        if (changed && time(NULL) != lastSave)
+        {
+            saveFrame(&frame, file, number);
+            changed = false;
+            lastSave = time(NULL);
+        }
+
+        struct pollfd ready = { fd, POLLIN, 0 };
+        if (poll(&ready, 1, 1000) <= 0)
+        {
+            continue;
+        }
+
+        ssize_t bytes = recv(fd, &message[0], message.size(), 0);
+        LiveHeader header;
+        if (bytes < (ssize_t)sizeof(header))
+        {
+            continue;
+        }
+        memcpy(&header, &message[0], sizeof(header));
+        if (header.magic != LIVE_MAGIC || header.frameWidth <= 0 || header.frameHeight <= 0)
+        {
+            continue;
+        }
+
+        //A frame starts again on its marker, or on a tile of another size
+        //when the marker was dropped.
+        if (header.kind == LIVE_BEGIN || header.frameWidth != frame.data.width || header.frameHeight != frame.data.height)
+        {
+            startFrame(&frame, header.frameWidth, header.frameHeight);
+        }
+
+        if (header.kind == LIVE_TILE)
+        {
+            changed = pasteTile(&frame, header, &message[sizeof(header)], bytes - sizeof(header)) || changed;
+        }
+        else if (header.kind == LIVE_END)
+        {
+            saveFrame(&frame, file, number);
+            changed = false;
+            frame.pixels.clear();
+            frame.data.width = frame.data.height = 0;
+            number++;
+        }
+    }
+
+    close(fd);
+    unlink(path.c_str());
+    return 0;
+}
@@ -0,0 +1,432 @@
+//This tool predicts how every partitioning scheme would do on a scene, from
+//a cost grid written by -costmap, without running it on the cluster. Each
+//cell's cost is spread evenly over its pixels, the work is cut up the same
+//way that master.cpp and slave.cpp cut it up, and messages are charged
+//latency + size / bandwidth on the master's link, one at a time.
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include "costmap.h"
+#include "partition.h"
+#include "options.h"
+
+//The network between the slaves and the master.
+typedef struct
+{
+    double latency;
+    double bandwidth;
+} SimNetwork;
+
+//What one scheme is predicted to do.
+typedef struct
+{
+    double makespan;
+    double computation;
+    double communication;
+    double imbalance;
+} SimResult;
+
+//The shading time of every pixel, as a summed-area table so that the cost of
+//any rectangle is four lookups.
+typedef struct
+{
+    int width;
+    int height;
+    std::vector<double> sums;
+} CostImage;
+
+static double rectCost(const CostImage* image, int firstRow, int firstCol, int lastRow, int lastCol)
+{
+    firstRow = std::max(firstRow, 0);
+    firstCol = std::max(firstCol, 0);
+    lastRow = std::min(lastRow, image->height - 1);
+    lastCol = std::min(lastCol, image->width - 1);
+    if (lastRow < firstRow || lastCol < firstCol) {
+        return 0.0;
+    }
+    int stride = image->width + 1;
+    return image->sums[(lastRow + 1) * stride + lastCol + 1] - image->sums[firstRow * stride + lastCol + 1]
+         - image->sums[(lastRow + 1) * stride + firstCol] + image->sums[firstRow * stride + firstCol];
+}
+
+//Spread the grid over a width x height image, in seconds.
+static void buildCostImage(const CostMap* map, int width, int height, double ghz, CostImage* image)
+{
+    //Every pixel of the measured image had its share of its cell.
+    std::vector<int> cellPixels(map->cost.size(), 0);
+    for (int row = 0; row < map->height; ++row) {
+        for (int col = 0; col < map->width; ++col) {
+            cellPixels[costMapCell(map, row, col)]++;
+        }
+    }
+
+    image->width = width;
+    image->height = height;
+    image->sums.assign((size_t)(width + 1) * (height + 1), 0.0);
+    int stride = width + 1;
+    for (int row = 0; row < height; ++row) {
+        double rowSum = 0.0;
+        int mappedRow = (int)((long)row * map->height / height);
+        for (int col = 0; col < width; ++col) {
+            int cell = costMapCell(map, mappedRow, (int)((long)col * map->width / width));
+            //A pixel costs the same at any resolution, so a larger image
+            //just has more of them.
+            rowSum += map->cost[cell] / std::max(cellPixels[cell], 1) / (ghz * 1e9);
+            image->sums[(row + 1) * stride + col + 1] = image->sums[row * stride + col + 1] + rowSum;
+        }
+    }
+}
+
+static double transferTime(const SimNetwork* network, long floats)
+{
+    return network->latency + floats * sizeof(float) / network->bandwidth;
+}
+
+static void finishResult(const std::vector<double>& rankCompute, SimResult* result)
+{
+    double total = 0.0, highest = 0.0;
+    int busy = 0;
+    for (size_t i = 0; i < rankCompute.size(); ++i) {
+        total += rankCompute[i];
+        highest = std::max(highest, rankCompute[i]);
+        if (rankCompute[i] > 0.0) busy++;
+    }
+    result->computation = total;
+    result->imbalance = busy > 0 && total > 0.0 ? highest / (total / busy) : 1.0;
+}
+
+//One message from a slave, ready to go at a given time.
+typedef struct
+{
+    double ready;
+    double transfer;
+} SimMessage;
+
+//Simulate static regions: every rank renders its rows in bands and each
+//band is sent to the master when it is done, as in bands.cpp.
+static SimResult simulateStatic(const CostImage* image, const SimNetwork* network,
+                                const std::vector< std::vector<int> >& rows,
+                                const std::vector<int>& firstCols, const std::vector<int>& numCols)
+{
+    SimResult result;
+    std::vector<double> rankCompute(rows.size(), 0.0);
+    std::vector<SimMessage> messages;
+
+    for (size_t rank = 0; rank < rows.size(); ++rank) {
+        int numRows = rows[rank].size();
+        int bands = bandCount(numRows);
+        double clock = 0.0;
+        for (int band = 0; band < bands; ++band) {
+            int first, count;
+            bandRows(numRows, band, &first, &count);
+            for (int i = first; i < first + count; ++i) {
+                clock += rectCost(image, rows[rank][i], firstCols[rank], rows[rank][i], firstCols[rank] + numCols[rank] - 1);
+            }
+            if (rank > 0) {
+                SimMessage message;
+                message.ready = clock;
+                message.transfer = transferTime(network, 3L * count * numCols[rank] + (band == bands - 1 ? 1 : 0));
+                messages.push_back(message);
+            }
+        }
+        rankCompute[rank] = clock;
+    }
+
+    //The master's link takes one message at a time.
+    std::sort(messages.begin(), messages.end(), [](const SimMessage& a, const SimMessage& b) { return a.ready < b.ready; });
+    double linkFree = 0.0;
+    result.communication = 0.0;
+    for (size_t i = 0; i < messages.size(); ++i) {
+        linkFree = std::max(linkFree, messages[i].ready) + messages[i].transfer;
+        result.communication += messages[i].transfer;
+    }
+
+    result.makespan = std::max(rankCompute[0], linkFree);
+    finishResult(rankCompute, &result);
+    return result;
+}
+
+static SimResult simulateStripsVertical(const CostImage* image, const SimNetwork* network, int procs)
+{
+    std::vector< std::vector<int> > rows(procs);
+    std::vector<int> firstCols(procs), numCols(procs);
+    int cols = image->width / procs;
+    int extra = image->width % procs;
+    for (int rank = 0; rank < procs; ++rank) {
+        for (int row = 0; row < image->height; ++row) rows[rank].push_back(row);
+        firstCols[rank] = rank * cols;
+        numCols[rank] = rank == procs - 1 ? cols + extra : cols;
+    }
+    return simulateStatic(image, network, rows, firstCols, numCols);
+}
+
+//The same squares as staticSquareBlocksMaster().
+static SimResult simulateBlocks(const CostImage* image, const SimNetwork* network, int procs)
+{
+    int square = 0;
+    int root = (int)sqrt(procs);
+    float test = (float)procs / (float)root;
+    if (test != root) {
+        square = ((int)sqrt(procs) + 1) * ((int)sqrt(procs) + 1);
+    } else {
+        square = procs;
+    }
+
+    int size = image->width * image->height / square;
+    int dim = std::max(1, (int)sqrt(size));
+    int max = std::max(1, image->width / dim);
+    int hOffset = image->width - dim * max;
+    if (hOffset > 1) hOffset /= 2;
+    int vOffset = image->height - dim * max;
+    if (vOffset > 1) vOffset /= 2;
+
+    std::vector< std::vector<int> > rows(procs);
+    std::vector<int> firstCols(procs), numCols(procs);
+    for (int rank = 0; rank < procs; ++rank) {
+        int firstCol = (rank % max) * dim + hOffset;
+        int lastCol = firstCol + dim - 1;
+        int firstRow = (rank / max) * dim + vOffset;
+        int lastRow = firstRow + dim - 1;
+        if (firstCol == hOffset) firstCol = 0;
+        if (lastCol == dim * max + hOffset) lastCol = image->width - 1;
+        if (firstRow == vOffset) firstRow = 0;
+        if (lastRow == dim * max + vOffset || (procs - rank - 1) < max) lastRow = image->height - 1;
+
+        for (int row = firstRow; row <= lastRow; ++row) rows[rank].push_back(row);
+        firstCols[rank] = firstCol;
+        numCols[rank] = lastCol - firstCol + 1;
+    }
+    return simulateStatic(image, network, rows, firstCols, numCols);
+}
+
+static SimResult simulateCycles(const CostImage* image, const SimNetwork* network, int procs, int cycleSize)
+{
+    std::vector< std::vector<int> > rows(procs);
+    std::vector<int> firstCols(procs, 0), numCols(procs, image->width);
+    for (int rank = 0; rank < procs; ++rank) {
+        for (int startRow = rank * cycleSize; startRow < image->height; startRow += cycleSize * procs) {
+            for (int r = 0; r < cycleSize && startRow + r < image->height; ++r) {
+                rows[rank].push_back(startRow + r);
+            }
+        }
+    }
+    return simulateStatic(image, network, rows, firstCols, numCols);
+}
+
+//Hand out the units in order to whichever rank is free first. A slave asks
+//for each unit (two small messages) and sends the result back over the
+//master's link; the master, in hybrid mode, renders units itself.
+static void simulatePool(const CostImage* image, const SimNetwork* network, std::queue<WorkUnit>* pool,
+                         std::vector<double>* rankFree, std::vector<double>* rankCompute, bool masterWorks,
+                         double* linkFree, double* communication)
+{
+    typedef std::pair<double, int> Ready;
+    std::priority_queue<Ready, std::vector<Ready>, std::greater<Ready> > ready;
+    for (size_t rank = masterWorks ? 0 : 1; rank < rankFree->size(); ++rank) {
+        ready.push(Ready((*rankFree)[rank], rank));
+    }
+
+    while (!pool->empty() && !ready.empty()) {
+        WorkUnit unit = pool->front();
+        pool->pop();
+        Ready next = ready.top();
+        ready.pop();
+
+        double cost = rectCost(image, unit.startRow, unit.startCol,
+                               unit.startRow + unit.blockHeight - 1, unit.startCol + unit.blockWidth - 1);
+        (*rankCompute)[next.second] += cost;
+        double clock = next.first;
+        if (next.second == 0) {
+            clock += cost;
+        }
+        else {
+            double request = 2.0 * network->latency;
+            double transfer = transferTime(network, 3L * unit.blockWidth * unit.blockHeight + 1);
+            *linkFree = std::max(*linkFree, clock + request + cost) + transfer;
+            *communication += request + transfer;
+            clock = *linkFree;
+        }
+        (*rankFree)[next.second] = clock;
+        ready.push(Ready(clock, next.second));
+    }
+}
+
+static SimResult simulateDynamic(const CostImage* image, const SimNetwork* network, int procs, ConfigData* data)
+{
+    SimResult result;
+    std::queue<WorkUnit> pool;
+    createDynamicUnits(data, 0, &pool);
+
+    std::vector<double> rankFree(procs, 0.0), rankCompute(procs, 0.0);
+    double linkFree = 0.0;
+    result.communication = 0.0;
+    simulatePool(image, network, &pool, &rankFree, &rankCompute, false, &linkFree, &result.communication);
+
+    result.makespan = *std::max_element(rankFree.begin(), rankFree.end());
+    finishResult(rankCompute, &result);
+    return result;
+}
+
+static SimResult simulateHybrid(const CostImage* image, const SimNetwork* network, int procs, ConfigData* data)
+{
+    SimResult result;
+    std::vector<double> rankFree(procs, 0.0), rankCompute(procs, 0.0);
+    std::vector<SimMessage> strips;
+    int staticCols = 0;
+
+    for (int rank = 0; rank < procs; ++rank) {
+        int firstCol, lastCol;
+        staticCols = hybridStripColumns(data, rank, &firstCol, &lastCol);
+        rankCompute[rank] = rectCost(image, 0, firstCol, image->height - 1, lastCol);
+        rankFree[rank] = rankCompute[rank];
+        if (rank > 0) {
+            SimMessage message;
+            message.ready = rankCompute[rank];
+            message.transfer = transferTime(network, 3L * image->height * std::max(lastCol - firstCol + 1, 0) + 1);
+            strips.push_back(message);
+        }
+    }
+
+    std::sort(strips.begin(), strips.end(), [](const SimMessage& a, const SimMessage& b) { return a.ready < b.ready; });
+    double linkFree = 0.0;
+    result.communication = 0.0;
+    for (size_t i = 0; i < strips.size(); ++i) {
+        linkFree = std::max(linkFree, strips[i].ready) + strips[i].transfer;
+        result.communication += strips[i].transfer;
+    }
+
+    std::queue<WorkUnit> pool;
+    createDynamicUnits(data, staticCols, &pool);
+    simulatePool(image, network, &pool, &rankFree, &rankCompute, true, &linkFree, &result.communication);
+
+    result.makespan = std::max(linkFree, *std::max_element(rankFree.begin(), rankFree.end()));
+    finishResult(rankCompute, &result);
+    return result;
+}
+
+static void printResult(const char* scheme, const SimResult& result)
+{
+    std::cout << std::left << std::setw(28) << scheme << std::right
+              << std::setw(12) << result.makespan
+              << std::setw(12) << result.imbalance
+              << std::setw(12) << (result.computation > 0.0 ? result.communication / result.computation : 0.0)
+              << std::endl;
+}
+
+static void usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " map.cost [options]" << std::endl;
+    std::cerr << "    -np <n,n,...>     process counts to simulate (default 4)" << std::endl;
+    std::cerr << "    -w <w> -h <h>     image size (default: the size the map was measured at)" << std::endl;
+    std::cerr << "    -bw <w> -bh <h>   dynamic block size (default 16 x 16)" << std::endl;
+    std::cerr << "    -cs <rows>        cycle size (default 4)" << std::endl;
+    std::cerr << "    -sf <fraction>    static share for hybrid (default 0.8)" << std::endl;
+    std::cerr << "    -bands <count>    bands per static region (default 8)" << std::endl;
+    std::cerr << "    -latency <us>     message latency (default 2)" << std::endl;
+    std::cerr << "    -bandwidth <GB/s> bandwidth into the master (default 5)" << std::endl;
+    std::cerr << "    -ghz <ghz>        time stamp counter rate of the measuring machine (default 2.5)" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argv[1][0] == '-') {
+        usage(argv[0]);
+        return 1;
+    }
+
+    CostMap map;
+    if (!costMapRead(argv[1], &map)) {
+        std::cerr << "The file (" << argv[1] << ") is not a cost map." << std::endl;
+        return 1;
+    }
+
+    ConfigData data;
+    data.width = map.width;
+    data.height = map.height;
+    data.dynamicBlockWidth = 16;
+    data.dynamicBlockHeight = 16;
+    data.cycleSize = 4;
+    runOptions.staticFraction = 0.8;
+    runOptions.bands = 8;
+
+    std::vector<int> procCounts(1, 4);
+    SimNetwork network = { 2e-6, 5e9 };
+    double ghz = 2.5;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "-np") {
+            procCounts.clear();
+            for (const char* p = value; *p; ) {
+                procCounts.push_back(atoi(p));
+                p = strchr(p, ',');
+                if (p == NULL) break;
+                ++p;
+            }
+        }
+        else if (arg == "-w") data.width = atoi(value);
+        else if (arg == "-h") data.height = atoi(value);
+        else if (arg == "-bw") data.dynamicBlockWidth = atoi(value);
+        else if (arg == "-bh") data.dynamicBlockHeight = atoi(value);
+        else if (arg == "-cs") data.cycleSize = atoi(value);
+        else if (arg == "-sf") runOptions.staticFraction = atof(value);
+        else if (arg == "-bands") runOptions.bands = atoi(value);
+        else if (arg == "-latency") network.latency = atof(value) * 1e-6;
+        else if (arg == "-bandwidth") network.bandwidth = atof(value) * 1e9;
+        else if (arg == "-ghz") ghz = atof(value);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (data.width <= 0 || data.height <= 0 || data.dynamicBlockWidth <= 0 || data.dynamicBlockHeight <= 0
+        || data.cycleSize <= 0 || runOptions.bands < 1 || ghz <= 0.0 || network.bandwidth <= 0.0) {
+        std::cerr << "ERROR: the sizes, -bands, -ghz and -bandwidth must be positive" << std::endl;
+        return 1;
+    }
+
+    CostImage image;
+    buildCostImage(&map, data.width, data.height, ghz, &image);
+    double total = rectCost(&image, 0, 0, image.height - 1, image.width - 1);
+
+    std::cout << "Cost map: " << argv[1] << " (" << map.cols << " x " << map.rows << " cells, measured at "
+              << map.width << " x " << map.height << ")" << std::endl;
+    std::cout << "Width x Height: " << data.width << " x " << data.height << std::endl;
+    std::cout << "Sequential shading time: " << total << " seconds" << std::endl;
+    std::cout << "Network: " << network.latency * 1e6 << " us latency, " << network.bandwidth / 1e9 << " GB/s" << std::endl;
+
+    for (size_t n = 0; n < procCounts.size(); ++n) {
+        int procs = procCounts[n];
+        if (procs < 1) continue;
+        data.mpi_procs = procs;
+
+        std::cout << std::endl << "Number of Processes: " << procs << std::endl;
+        std::cout << std::left << std::setw(28) << "Scheme" << std::right << std::setw(12) << "Makespan"
+                  << std::setw(12) << "Imbalance" << std::setw(12) << "C-to-C" << std::endl;
+
+        SimResult none = { total, total, 0.0, 1.0 };
+        printResult("none", none);
+        printResult("static_strips_vertical", simulateStripsVertical(&image, &network, procs));
+        printResult("static_blocks", simulateBlocks(&image, &network, procs));
+        printResult("static_cycles_horizontal", simulateCycles(&image, &network, procs, data.cycleSize));
+        if (procs > 1) {
+            printResult("dynamic", simulateDynamic(&image, &network, procs, &data));
+        }
+        printResult("hybrid", simulateHybrid(&image, &network, procs, &data));
+    }
+    return 0;
+}
@@ -0,0 +1,516 @@
+//This tool reads the output of many raytrace_mpi runs (for example
+//std/rt_mpi_*.out) and turns it into a scaling report. Every run is found
+//by its summary block, and the runs are grouped by scene, image size,
+//partitioning mode and number of processes. Each group is compared to the
+//fastest -p none run on the fewest processes of the same scene and size:
+//
+//    speedup = baseline time / best time of the group
+//    efficiency = speedup / processes
+//
+//The report is written as <prefix>.csv, with one line per group, and as
+//two SVG charts per scene and size, <prefix>_<scene>_<w>x<h>_speedup.svg
+//and ..._efficiency.svg, with one line per mode. The image of every run is
+//compared with the image of the baseline run; a run whose image is
+//different is flagged in the CSV, circled in red in the charts and listed
+//at the end. Runs with -roi render only part of the image, so they are
+//left out.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <png.h>
+
+//Define a structure that will be used to hold one run.
+typedef struct
+{
+    std::string log;
+    std::string scene;
+    int width;
+    int height;
+    int mode;
+    int procs;
+    int blockWidth;
+    int blockHeight;
+    int cycleSize;
+    double execution;
+    double computation;
+    double communication;
+    double ratio;
+    std::string image;
+    bool region;
+
+    //The result of comparing the image with the baseline's.
+    std::string imageCheck;
+    bool imageFailed;
+} Run;
+
+//Define a structure that will be used to hold the runs of one group.
+typedef struct
+{
+    std::vector<int> runs;
+    double best;
+    double mean;
+    double speedup;
+    double efficiency;
+    int failed;
+    int unchecked;
+} Group;
+
+std::string modeName(int mode)
+{
+    switch (mode)
+    {
+        case 0: return "none";
+        case 1: return "static_strips_horizontal";
+        case 2: return "static_strips_vertical";
+        case 4: return "static_blocks";
+        case 8: return "static_cycles_horizontal";
+        case 32: return "dynamic";
+        case 64: return "hybrid";
+    }
+    std::ostringstream name;
+    name << "mode_" << mode;
+    return name.str();
+}
+
+//The mode with the options that change how it splits the image.
+std::string modeLabel(const Run& run)
+{
+    std::ostringstream label;
+    label << modeName(run.mode);
+    if (run.mode == 32 || run.mode == 64) {
+        label << " " << run.blockWidth << "x" << run.blockHeight;
+    }
+    else if (run.mode == 8) {
+        label << " cs " << run.cycleSize;
+    }
+    return label.str();
+}
+
+//Read the value after a prefix such as "Execution Time: ".
+bool readAfter(const std::string& line, const char* prefix, std::string* value)
+{
+    size_t length = strlen(prefix);
+    if (line.compare(0, length, prefix) != 0) {
+        return false;
+    }
+    *value = line.substr(length);
+    return true;
+}
+
+void readLog(const std::string& filename, std::vector<Run>* runs)
+{
+    std::ifstream in(filename.c_str());
+    if (!in) {
+        std::cerr << "Could not read " << filename << std::endl;
+        return;
+    }
+
+    Run run;
+    bool open = false;
+    std::string line, value;
+    while (true) {
+        bool more = (bool)std::getline(in, line);
+
+        //A run ends where the next one starts, or at the end of the file.
+        if (!more || line.compare(0, 7, "Scene: ") == 0) {
+            if (open && run.execution >= 0.0 && !run.region) {
+                runs->push_back(run);
+            }
+            if (!more) {
+                break;
+            }
+            run = Run();
+            run.log = filename;
+            run.width = run.height = run.procs = run.blockWidth = run.blockHeight = run.cycleSize = 0;
+            run.mode = -1;
+            run.execution = -1.0;
+            run.computation = run.communication = run.ratio = 0.0;
+            run.imageFailed = false;
+            run.region = false;
+            open = true;
+        }
+        if (!open) {
+            continue;
+        }
+
+        if (readAfter(line, "Scene: ", &value)) run.scene = value;
+        else if (readAfter(line, "Width x Height: ", &value)) sscanf(value.c_str(), "%d x %d", &run.width, &run.height);
+        else if (readAfter(line, "Partitioning scheme: ", &value)) run.mode = atoi(value.c_str());
+        else if (readAfter(line, "Number of Processes: ", &value)) run.procs = atoi(value.c_str());
+        else if (readAfter(line, "Dynamic block size: ", &value)) sscanf(value.c_str(), "%d x %d", &run.blockWidth, &run.blockHeight);
+        else if (readAfter(line, "Cycle Size: ", &value)) run.cycleSize = atoi(value.c_str());
+        else if (readAfter(line, "Execution Time: ", &value)) run.execution = atof(value.c_str());
+        else if (readAfter(line, "Total Computation Time: ", &value)) run.computation = atof(value.c_str());
+        else if (readAfter(line, "Total Communication Time: ", &value)) run.communication = atof(value.c_str());
+        else if (readAfter(line, "C-to-C Ratio: ", &value)) run.ratio = atof(value.c_str());
+        else if (readAfter(line, "Image will be save to: ", &value)) run.image = value;
+        else if (readAfter(line, "Region of Interest: ", &value)) run.region = true;
+    }
+}
+
+//Read a PNG as 8 bit RGB.
+bool readImage(const std::string& filename, int* width, int* height, std::vector<unsigned char>* bytes)
+{
+    png_image png;
+    memset(&png, 0, sizeof(png));
+    png.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&png, filename.c_str())) {
+        return false;
+    }
+    png.format = PNG_FORMAT_RGB;
+    bytes->resize(PNG_IMAGE_SIZE(png));
+    if (!png_image_finish_read(&png, NULL, &(*bytes)[0], 0, NULL)) {
+        return false;
+    }
+    *width = png.width;
+    *height = png.height;
+    return true;
+}
+
+//Compare the image of a run with the baseline image and describe it.
+void checkImage(Run* run, const std::string& root, const std::string& baseline)
+{
+    static std::map<std::string, std::vector<unsigned char> > cache;
+    static std::map<std::string, std::pair<int, int> > sizes;
+
+    if (baseline.empty()) {
+        run->imageCheck = "no baseline";
+        return;
+    }
+    if (run->image.size() < 4 || run->image.substr(run->image.size() - 4) != ".png") {
+        run->imageCheck = "not png";
+        return;
+    }
+
+    std::string files[2] = { baseline, run->image };
+    for (int i = 0; i < 2; ++i) {
+        if (!cache.count(files[i])) {
+            int width, height;
+            if (!readImage(root + "/" + files[i], &width, &height, &cache[files[i]])) {
+                cache.erase(files[i]);
+                run->imageCheck = (i == 0 ? "baseline missing: " : "missing: ") + files[i];
+                run->imageFailed = i == 1;
+                return;
+            }
+            sizes[files[i]] = std::make_pair(width, height);
+        }
+    }
+
+    if (sizes[baseline] != sizes[run->image]) {
+        run->imageCheck = "different size";
+        run->imageFailed = true;
+        return;
+    }
+    const std::vector<unsigned char>& a = cache[baseline];
+    const std::vector<unsigned char>& b = cache[run->image];
+    long long different = 0;
+    for (size_t i = 0; i < a.size(); i += 3) {
+        if (a[i] != b[i] || a[i + 1] != b[i + 1] || a[i + 2] != b[i + 2]) {
+            different++;
+        }
+    }
+    std::ostringstream check;
+    if (different == 0) {
+        check << "ok";
+    }
+    else {
+        check << different << " pixels differ";
+        run->imageFailed = true;
+    }
+    run->imageCheck = check.str();
+}
+
+//Turn a scene path into something that can go in a file name.
+std::string fileSafe(const std::string& scene)
+{
+    std::string name = scene.substr(scene.find_last_of('/') + 1);
+    name = name.substr(0, name.find_last_of('.'));
+    for (size_t i = 0; i < name.size(); ++i) {
+        if (!isalnum((unsigned char)name[i])) {
+            name[i] = '_';
+        }
+    }
+    return name;
+}
+
+//Define a structure that will be used to hold one line of a chart.
+typedef struct
+{
+    std::string label;
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<bool> flagged;
+} Series;
+
+//Write a line chart with the processes along the bottom. With ideal set,
+//a dashed line shows perfect scaling (y = x for speedup, y = 1 otherwise).
+bool writeChart(const std::string& filename, const std::string& title, const std::string& yName,
+                const std::vector<Series>& series, bool idealSpeedup)
+{
+    static const char* colors[] = { "#1f77b4", "#ff7f0e", "#2ca02c", "#9467bd", "#8c564b",
+                                    "#e377c2", "#7f7f7f", "#bcbd22", "#17becf" };
+    const int width = 720, height = 440;
+    const int left = 60, right = 220, top = 40, bottom = 50;
+    int plotWidth = width - left - right, plotHeight = height - top - bottom;
+
+    double maxX = 1.0, maxY = idealSpeedup ? 1.0 : 1.2;
+    std::set<double> ticks;
+    for (size_t s = 0; s < series.size(); ++s) {
+        for (size_t i = 0; i < series[s].x.size(); ++i) {
+            maxX = std::max(maxX, series[s].x[i]);
+            maxY = std::max(maxY, series[s].y[i]);
+            ticks.insert(series[s].x[i]);
+        }
+    }
+    if (idealSpeedup) {
+        maxY = std::max(maxY, maxX);
+    }
+    maxY *= 1.05;
+
+    std::ofstream out(filename.c_str());
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width << "\" height=\"" << height
+        << "\" font-family=\"sans-serif\" font-size=\"12\">" << std::endl;
+    out << "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>" << std::endl;
+    out << "<text x=\"" << left << "\" y=\"24\" font-size=\"15\">" << title << "</text>" << std::endl;
+
+#define SX(v) (left + (v) / maxX * plotWidth)
+#define SY(v) (top + plotHeight - (v) / maxY * plotHeight)
+
+    //Axes, with a tick for every process count that was run.
+    out << "<line x1=\"" << left << "\" y1=\"" << top + plotHeight << "\" x2=\"" << left + plotWidth << "\" y2=\""
+        << top + plotHeight << "\" stroke=\"black\"/>" << std::endl;
+    out << "<line x1=\"" << left << "\" y1=\"" << top << "\" x2=\"" << left << "\" y2=\"" << top + plotHeight
+        << "\" stroke=\"black\"/>" << std::endl;
+    for (std::set<double>::iterator it = ticks.begin(); it != ticks.end(); ++it) {
+        out << "<text x=\"" << SX(*it) << "\" y=\"" << top + plotHeight + 16 << "\" text-anchor=\"middle\">" << *it << "</text>" << std::endl;
+    }
+    for (int i = 0; i <= 5; ++i) {
+        double value = maxY * i / 5;
+        out << "<line x1=\"" << left << "\" y1=\"" << SY(value) << "\" x2=\"" << left + plotWidth << "\" y2=\"" << SY(value)
+            << "\" stroke=\"#dddddd\"/>" << std::endl;
+        out << "<text x=\"" << left - 6 << "\" y=\"" << SY(value) + 4 << "\" text-anchor=\"end\">"
+            << (int)(value * 100 + 0.5) / 100.0 << "</text>" << std::endl;
+    }
+    out << "<text x=\"" << left + plotWidth / 2 << "\" y=\"" << height - 12 << "\" text-anchor=\"middle\">Processes</text>" << std::endl;
+    out << "<text x=\"16\" y=\"" << top + plotHeight / 2 << "\" text-anchor=\"middle\" transform=\"rotate(-90 16 "
+        << top + plotHeight / 2 << ")\">" << yName << "</text>" << std::endl;
+
+    //Perfect scaling.
+    out << "<line x1=\"" << SX(0.0) << "\" y1=\"" << SY(idealSpeedup ? 0.0 : 1.0) << "\" x2=\"" << SX(maxX) << "\" y2=\""
+        << SY(idealSpeedup ? maxX : 1.0) << "\" stroke=\"#999999\" stroke-dasharray=\"5,4\"/>" << std::endl;
+
+    for (size_t s = 0; s < series.size(); ++s) {
+        const char* color = colors[s % (sizeof(colors) / sizeof(colors[0]))];
+        out << "<polyline fill=\"none\" stroke=\"" << color << "\" stroke-width=\"2\" points=\"";
+        for (size_t i = 0; i < series[s].x.size(); ++i) {
+            out << SX(series[s].x[i]) << "," << SY(series[s].y[i]) << " ";
+        }
+        out << "\"/>" << std::endl;
+        for (size_t i = 0; i < series[s].x.size(); ++i) {
+            out << "<circle cx=\"" << SX(series[s].x[i]) << "\" cy=\"" << SY(series[s].y[i]) << "\" r=\"3\" fill=\"" << color << "\"/>" << std::endl;
+            if (series[s].flagged[i]) {
+                out << "<circle cx=\"" << SX(series[s].x[i]) << "\" cy=\"" << SY(series[s].y[i])
+                    << "\" r=\"8\" fill=\"none\" stroke=\"red\" stroke-width=\"2\"/>" << std::endl;
+            }
+        }
+
+        //The legend.
+        int y = top + 10 + 18 * s;
+        out << "<line x1=\"" << width - right + 20 << "\" y1=\"" << y << "\" x2=\"" << width - right + 44 << "\" y2=\"" << y
+            << "\" stroke=\"" << color << "\" stroke-width=\"2\"/>" << std::endl;
+        out << "<text x=\"" << width - right + 50 << "\" y=\"" << y + 4 << "\">" << series[s].label << "</text>" << std::endl;
+    }
+    int y = top + 10 + 18 * series.size();
+    out << "<circle cx=\"" << width - right + 32 << "\" cy=\"" << y << "\" r=\"6\" fill=\"none\" stroke=\"red\" stroke-width=\"2\"/>" << std::endl;
+    out << "<text x=\"" << width - right + 50 << "\" y=\"" << y + 4 << "\">image differs</text>" << std::endl;
+    out << "</svg>" << std::endl;
+
+#undef SX
+#undef SY
+    return out.good();
+}
+
+int main(int argc, char* argv[])
+{
+    std::string prefix = "scaling";
+    std::string root = ".";
+    std::vector<std::string> logs;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) prefix = argv[++i];
+        else if (strcmp(argv[i], "-root") == 0 && i + 1 < argc) root = argv[++i];
+        else logs.push_back(argv[i]);
+    }
+    if (logs.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " [-o prefix] [-root dir] log..." << std::endl;
+        std::cerr << "    Reads the output of raytrace_mpi runs and writes prefix.csv and SVG" << std::endl;
+        std::cerr << "    charts of speedup and efficiency. -root is the directory the runs" << std::endl;
+        std::cerr << "    were started in, where their renders/ images are (default .)." << std::endl;
+        return 1;
+    }
+
+    std::vector<Run> runs;
+    for (size_t i = 0; i < logs.size(); ++i)
+    {
+        readLog(logs[i], &runs);
+    }
+    std::cout << "Read " << runs.size() << " runs from " << logs.size() << " files." << std::endl;
+
+    //The baseline of every scene and size is its fastest -p none run on the
+    //fewest processes, as the other processes only wait in that mode.
+    std::map<std::string, int> baselines;
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        std::ostringstream key;
+        key << runs[i].scene << "|" << runs[i].width << "x" << runs[i].height;
+        if (runs[i].mode != 0) {
+            continue;
+        }
+        const Run* best = baselines.count(key.str()) ? &runs[baselines[key.str()]] : NULL;
+        if (best == NULL || runs[i].procs < best->procs || (runs[i].procs == best->procs && runs[i].execution < best->execution))
+        {
+            baselines[key.str()] = i;
+        }
+    }
+
+    //Group the runs, in the order scene, size, mode and processes.
+    typedef std::pair<std::string, int> GroupKey;
+    std::map<GroupKey, Group> groups;
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        Run* run = &runs[i];
+        std::ostringstream key;
+        key << run->scene << "|" << run->width << "x" << run->height;
+        int baseline = baselines.count(key.str()) ? baselines[key.str()] : -1;
+        if (baseline == (int)i)
+        {
+            run->imageCheck = "baseline";
+        }
+        else
+        {
+            checkImage(run, root, baseline >= 0 ? runs[baseline].image : "");
+        }
+
+        key << "|" << modeLabel(*run);
+        Group* group = &groups[GroupKey(key.str(), run->procs)];
+        group->runs.push_back(i);
+    }
+
+    std::ofstream csv((prefix + ".csv").c_str());
+    csv << "scene,width,height,mode,processes,runs,best_time,mean_time,speedup,efficiency,"
+        << "computation_time,communication_time,c2c_ratio,images" << std::endl;
+
+    //Chart lines, by scene and size and then by mode.
+    std::map<std::string, std::map<std::string, Series> > charts;
+    std::vector<int> failures;
+    for (std::map<GroupKey, Group>::iterator it = groups.begin(); it != groups.end(); ++it)
+    {
+        Group* group = &it->second;
+        const Run& first = runs[group->runs[0]];
+        std::ostringstream sceneKey;
+        sceneKey << first.scene << "|" << first.width << "x" << first.height;
+        int baseline = baselines.count(sceneKey.str()) ? baselines[sceneKey.str()] : -1;
+
+        group->best = first.execution;
+        group->mean = 0.0;
+        group->failed = group->unchecked = 0;
+        double computation = 0.0, communication = 0.0, ratio = 0.0;
+        for (size_t r = 0; r < group->runs.size(); ++r)
+        {
+            const Run& run = runs[group->runs[r]];
+            group->best = std::min(group->best, run.execution);
+            group->mean += run.execution / group->runs.size();
+            computation += run.computation / group->runs.size();
+            communication += run.communication / group->runs.size();
+            if (run.ratio == run.ratio) {
+                ratio += run.ratio / group->runs.size();
+            }
+            if (run.imageFailed)
+            {
+                group->failed++;
+                failures.push_back(group->runs[r]);
+            }
+            else if (run.imageCheck != "ok" && run.imageCheck != "baseline")
+            {
+                group->unchecked++;
+            }
+        }
+        group->speedup = baseline >= 0 && group->best > 0.0 ? runs[baseline].execution / group->best : 0.0;
+        group->efficiency = first.procs > 0 ? group->speedup / first.procs : 0.0;
+
+        std::ostringstream images;
+        if (group->failed > 0) images << "FAILED (" << group->failed << " of " << group->runs.size() << ")";
+        else if (group->unchecked > 0) images << "unchecked (" << group->unchecked << " of " << group->runs.size() << ")";
+        else images << "ok";
+
+        std::string scene = first.scene;
+        if (scene.find_first_of(",\"") != std::string::npos)
+        {
+            scene = "\"" + scene + "\"";
+        }
+        csv << scene << "," << first.width << "," << first.height << "," << modeLabel(first) << "," << first.procs << ","
+            << group->runs.size() << "," << group->best << "," << group->mean << ","
+            << (baseline >= 0 ? group->speedup : 0.0) << "," << (baseline >= 0 ? group->efficiency : 0.0) << ","
+            << computation << "," << communication << "," << ratio << "," << images.str() << std::endl;
+
+        if (baseline >= 0 && first.mode != 0)
+        {
+            Series* series = &charts[sceneKey.str()][modeLabel(first)];
+            series->label = modeLabel(first);
+            series->x.push_back(first.procs);
+            series->y.push_back(group->speedup);
+            series->flagged.push_back(group->failed > 0);
+        }
+    }
+    std::cout << "Wrote " << prefix << ".csv (" << groups.size() << " groups)" << std::endl;
+
+    for (std::map<std::string, std::map<std::string, Series> >::iterator it = charts.begin(); it != charts.end(); ++it)
+    {
+        std::string scene = it->first.substr(0, it->first.find('|'));
+        std::string size = it->first.substr(it->first.find('|') + 1);
+        std::vector<Series> speedup, efficiency;
+        for (std::map<std::string, Series>::iterator s = it->second.begin(); s != it->second.end(); ++s)
+        {
+            speedup.push_back(s->second);
+            Series scaled = s->second;
+            for (size_t i = 0; i < scaled.x.size(); ++i)
+            {
+                scaled.y[i] /= scaled.x[i];
+            }
+            efficiency.push_back(scaled);
+        }
+
+        std::string base = prefix + "_" + fileSafe(scene) + "_" + size;
+        writeChart(base + "_speedup.svg", "Speedup: " + scene + " " + size, "Speedup", speedup, true);
+        writeChart(base + "_efficiency.svg", "Efficiency: " + scene + " " + size, "Efficiency", efficiency, false);
+        std::cout << "Wrote " << base << "_speedup.svg and " << base << "_efficiency.svg" << std::endl;
+    }
+
+    //Runs with no baseline cannot be charted.
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        if (runs[i].imageCheck == "no baseline")
+        {
+            std::cout << "No -p none run of " << runs[i].scene << " " << runs[i].width << "x" << runs[i].height
+                      << ", so it has no speedup." << std::endl;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < failures.size(); ++i)
+    {
+        const Run& run = runs[failures[i]];
+        std::cout << "IMAGE FAILED: " << run.log << ": " << run.scene << " " << run.width << "x" << run.height << " "
+                  << modeLabel(run) << " on " << run.procs << " processes: " << run.imageCheck << std::endl;
+    }
+    return failures.empty() ? 0 : 2;
+}
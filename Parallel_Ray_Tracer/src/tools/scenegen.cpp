@@ -0,0 +1,354 @@
+//This tool writes procedural scene files for scaling studies. A scene is a
+//checkered floor under a number of spheres and point lights, and the same
+//options and seed always give the same file, so a benchmark can be rerun
+//on any machine. The knobs set how much work a pixel is and how unevenly
+//that work is spread over the image:
+//
+//    -objects <n>       the number of spheres
+//    -reflective <f>    the share of spheres that are mirrors (0 - 1)
+//    -refractive <f>    the share that are glass (0 - 1); the rest are matte
+//    -clusters <k>      gather the spheres around k centres (0 spreads them
+//                       evenly over the floor)
+//    -spread <s>        how far the spheres stray from their centre, as a
+//                       share of the floor (0 - 1)
+//    -lights <n>        the number of point lights; every light adds a
+//                       shadow ray to every hit
+//    -seed <n>          the random seed
+//    -preset <name>     trivial, simple, medium, complex or extreme; the
+//                       other options change the preset
+//
+//Mirrors and glass spawn secondary rays, lights spawn shadow rays, and
+//tight clusters put most of that work into a few tiles, which is what the
+//partitioning modes have to balance.
+//
+//The scene is written in the engine's own format. The engine only loads
+//geometry from OBJ files, so next to scene.xml go scene.obj with every
+//sphere ("type sphere" with its sP centre and sR radius), scene_floor.obj
+//with the two triangles of the floor, and scene.mtl with a material per
+//sphere. The XML names the OBJ files by their path from the directory that
+//the ray tracer is run in, which is how it opens them.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+//The floor is a square of this half width centred under the camera.
+static const double FLOOR_SIZE = 20.0;
+
+//The camera looks at the middle of the floor with a square frame that
+//spans this angle, in degrees, at a focal distance of 1.
+static const double FIELD_OF_VIEW = 60.0;
+
+typedef struct
+{
+    int objects;
+    double reflective;
+    double refractive;
+    int clusters;
+    double spread;
+    int lights;
+    unsigned int seed;
+} SceneOptions;
+
+typedef struct
+{
+    double x, y, z;
+    double radius;
+    int material;
+} Sphere;
+
+//A small generator of our own, so that the scenes do not change with the
+//C library.
+static unsigned long long rngState;
+
+static double randomUnit()
+{
+    rngState = rngState * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (rngState >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double randomRange(double low, double high)
+{
+    return low + (high - low) * randomUnit();
+}
+
+static double randomNormal()
+{
+    double u = std::max(randomUnit(), 1e-12);
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * randomUnit());
+}
+
+static bool applyPreset(const std::string& name, SceneOptions* options)
+{
+    static const char* names[] = { "trivial", "simple", "medium", "complex", "extreme" };
+    static const SceneOptions presets[] = {
+        { 4, 0.0, 0.0, 0, 1.0, 1, 1 },
+        { 16, 0.25, 0.1, 0, 1.0, 1, 1 },
+        { 128, 0.3, 0.2, 4, 0.25, 2, 1 },
+        { 1024, 0.4, 0.3, 2, 0.1, 3, 1 },
+        { 8192, 0.5, 0.4, 1, 0.05, 4, 1 },
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        if (name == names[i]) {
+            *options = presets[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+//Write the material of a sphere to the MTL file. Matte, mirror and glass
+//each get a colour of their own; Kr is the share that is reflected, Tf the
+//share that is let through and Ni the index of refraction.
+static void writeMaterial(std::ofstream& out, int index, int kind)
+{
+    double r = randomRange(0.2, 1.0), g = randomRange(0.2, 1.0), b = randomRange(0.2, 1.0);
+    double diffuse = kind == 0 ? 0.9 : 0.1;
+    double reflection = kind == 1 ? 0.9 : (kind == 2 ? 0.1 : 0.0);
+    double transparency = kind == 2 ? 0.9 : 0.0;
+    double ior = kind == 2 ? 1.5 : 1.0;
+    out << "newmtl sphere" << index << std::endl;
+    out << "Ka " << 0.1 * r << " " << 0.1 * g << " " << 0.1 * b << std::endl;
+    out << "Kd " << diffuse * r << " " << diffuse * g << " " << diffuse * b << std::endl;
+    out << "Ks 0.5 0.5 0.5" << std::endl;
+    out << "Kr " << reflection << " " << reflection << " " << reflection << std::endl;
+    out << "Tf " << transparency << " " << transparency << " " << transparency << std::endl;
+    out << "Ns 32" << std::endl;
+    out << "Ni " << ior << std::endl;
+}
+
+//The name of a file without its directory.
+static std::string baseName(const std::string& path)
+{
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static void usage(const char* name)
+{
+    std::cerr << "Usage: " << name << " output.xml [-preset <name>] [-objects <n>] [-reflective <f>]" << std::endl;
+    std::cerr << "       [-refractive <f>] [-clusters <k>] [-spread <s>] [-lights <n>] [-seed <n>]" << std::endl;
+    std::cerr << "    Presets: trivial, simple, medium, complex, extreme (default medium)." << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argv[1][0] == '-')
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    SceneOptions options = { 0, 0.0, 0.0, 0, 0.0, 0, 0 };
+    applyPreset("medium", &options);
+
+    //The preset goes first so that the other options can change it.
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-preset") == 0 && !applyPreset(argv[i + 1], &options))
+        {
+            std::cerr << "ERROR: unknown preset " << argv[i + 1] << std::endl;
+            return 1;
+        }
+    }
+    for (int i = 2; i < argc; i += 2)
+    {
+        if (i + 1 >= argc)
+        {
+            std::cerr << "ERROR: " << argv[i] << " requires a value" << std::endl;
+            return 1;
+        }
+        std::string name = argv[i];
+        const char* value = argv[i + 1];
+        if (name == "-preset") continue;
+        else if (name == "-objects") options.objects = atoi(value);
+        else if (name == "-reflective") options.reflective = atof(value);
+        else if (name == "-refractive") options.refractive = atof(value);
+        else if (name == "-clusters") options.clusters = atoi(value);
+        else if (name == "-spread") options.spread = atof(value);
+        else if (name == "-lights") options.lights = atoi(value);
+        else if (name == "-seed") options.seed = strtoul(value, NULL, 10);
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (options.objects < 0 || options.lights < 1 || options.clusters < 0 || options.spread < 0.0
+        || options.reflective < 0.0 || options.refractive < 0.0 || options.reflective + options.refractive > 1.0)
+    {
+        std::cerr << "ERROR: -objects must be at least 0, -lights at least 1, and -reflective plus" << std::endl;
+        std::cerr << "       -refractive at most 1." << std::endl;
+        return 1;
+    }
+    rngState = options.seed * 0x9e3779b97f4a7c15ULL + 1;
+
+    //Place the spheres, on the floor and around their cluster centres.
+    std::vector<double> centreX, centreZ;
+    for (int k = 0; k < options.clusters; ++k)
+    {
+        centreX.push_back(randomRange(-0.8, 0.8) * FLOOR_SIZE);
+        centreZ.push_back(randomRange(-0.8, 0.8) * FLOOR_SIZE);
+    }
+    double radius = std::max(0.05, 0.5 * FLOOR_SIZE / sqrt((double)std::max(options.objects, 1)));
+    std::vector<Sphere> spheres(options.objects);
+    int counts[3] = { 0, 0, 0 };
+    for (int i = 0; i < options.objects; ++i)
+    {
+        Sphere* sphere = &spheres[i];
+        if (options.clusters == 0)
+        {
+            sphere->x = randomRange(-1.0, 1.0) * FLOOR_SIZE;
+            sphere->z = randomRange(-1.0, 1.0) * FLOOR_SIZE;
+        }
+        else
+        {
+            int k = i % options.clusters;
+            sphere->x = centreX[k] + randomNormal() * options.spread * FLOOR_SIZE;
+            sphere->z = centreZ[k] + randomNormal() * options.spread * FLOOR_SIZE;
+        }
+        sphere->radius = radius * randomRange(0.5, 1.5);
+        sphere->y = sphere->radius + randomRange(0.0, 2.0 * radius);
+
+        double kind = randomUnit();
+        sphere->material = kind < options.reflective ? 1 : (kind < options.reflective + options.refractive ? 2 : 0);
+        counts[sphere->material]++;
+    }
+
+    //The OBJ and MTL files are named after the XML file. The engine finds
+    //the MTL file in the directory of the OBJ file, so the path of the OBJ
+    //file always has one.
+    std::string sceneFile = argv[1];
+    std::string base = sceneFile;
+    if (base.size() > 4 && base.compare(base.size() - 4, 4, ".xml") == 0)
+    {
+        base.erase(base.size() - 4);
+    }
+    if (base.find('/') == std::string::npos)
+    {
+        base = "./" + base;
+    }
+    std::string sphereFile = base + ".obj";
+    std::string floorFile = base + "_floor.obj";
+    std::string materialFile = base + ".mtl";
+
+    std::ofstream materials(materialFile.c_str());
+    materials << "newmtl floor" << std::endl;
+    materials << "Ka 0.1 0.1 0.1" << std::endl;
+    materials << "Kd 0.8 0.8 0.8" << std::endl;
+    materials << "Ks 0.2 0.2 0.2" << std::endl;
+    materials << "Ns 8" << std::endl;
+    for (int i = 0; i < options.objects; ++i)
+    {
+        writeMaterial(materials, i, spheres[i].material);
+    }
+
+    std::ofstream objects(sphereFile.c_str());
+    objects << "mtllib " << baseName(materialFile) << std::endl;
+    for (int i = 0; i < options.objects; ++i)
+    {
+        const Sphere& sphere = spheres[i];
+        objects << "g sphere" << i << std::endl;
+        objects << "usemtl sphere" << i << std::endl;
+        objects << "type sphere" << std::endl;
+        objects << "sP " << sphere.x << " " << sphere.y << " " << sphere.z << std::endl;
+        objects << "sR " << sphere.radius << std::endl;
+    }
+
+    //The floor is two triangles, facing up.
+    std::ofstream floor(floorFile.c_str());
+    floor << "mtllib " << baseName(materialFile) << std::endl;
+    floor << "g floor" << std::endl;
+    floor << "usemtl floor" << std::endl;
+    floor << "v " << -FLOOR_SIZE << " 0 " << -FLOOR_SIZE << std::endl;
+    floor << "v " << FLOOR_SIZE << " 0 " << -FLOOR_SIZE << std::endl;
+    floor << "v " << FLOOR_SIZE << " 0 " << FLOOR_SIZE << std::endl;
+    floor << "v " << -FLOOR_SIZE << " 0 " << FLOOR_SIZE << std::endl;
+    floor << "vn 0 1 0" << std::endl;
+    floor << "f 1//1 3//1 2//1" << std::endl;
+    floor << "f 1//1 4//1 3//1" << std::endl;
+
+    std::ofstream out(sceneFile.c_str());
+    double frame = 2.0 * tan(0.5 * FIELD_OF_VIEW * M_PI / 180.0);
+    out << "<?xml version=\"1.0\"?>" << std::endl;
+    out << "<!-- scenegen: " << options.objects << " spheres, " << options.lights << " lights, "
+        << options.clusters << " clusters, spread " << options.spread << ", seed " << options.seed << " -->" << std::endl;
+    out << "<Scene>" << std::endl;
+
+    //The lights sit on a ring above the floor.
+    out << "  <Points>" << std::endl;
+    out << "    <Point ID=\"eye\" X=\"0\" Y=\"" << 0.6 * FLOOR_SIZE << "\" Z=\"" << -1.6 * FLOOR_SIZE << "\"/>" << std::endl;
+    out << "    <Point ID=\"lookAt\" X=\"0\" Y=\"0\" Z=\"0\"/>" << std::endl;
+    for (int l = 0; l < options.lights; ++l)
+    {
+        double angle = 2.0 * M_PI * l / options.lights;
+        out << "    <Point ID=\"light" << l << "\" X=\"" << FLOOR_SIZE * cos(angle) << "\" Y=\"" << FLOOR_SIZE
+            << "\" Z=\"" << FLOOR_SIZE * sin(angle) << "\"/>" << std::endl;
+    }
+    out << "  </Points>" << std::endl;
+    out << "  <Vectors>" << std::endl;
+    out << "    <Vector ID=\"up\" X=\"0\" Y=\"1\" Z=\"0\"/>" << std::endl;
+    out << "  </Vectors>" << std::endl;
+
+    //The lights share the light between them.
+    double intensity = 1.0 / options.lights;
+    out << "  <Colors>" << std::endl;
+    out << "    <Color ID=\"background\" R=\"0.1\" G=\"0.1\" B=\"0.2\"/>" << std::endl;
+    out << "    <Color ID=\"ambient\" R=\"" << 0.2 * intensity << "\" G=\"" << 0.2 * intensity
+        << "\" B=\"" << 0.2 * intensity << "\"/>" << std::endl;
+    out << "    <Color ID=\"light\" R=\"" << intensity << "\" G=\"" << intensity << "\" B=\"" << intensity << "\"/>" << std::endl;
+    out << "    <Color ID=\"checkLight\" R=\"0.9\" G=\"0.9\" B=\"0.9\"/>" << std::endl;
+    out << "    <Color ID=\"checkDark\" R=\"0.2\" G=\"0.2\" B=\"0.2\"/>" << std::endl;
+    out << "  </Colors>" << std::endl;
+    out << "  <Matrices>" << std::endl;
+    out << "  </Matrices>" << std::endl;
+
+    out << "  <World Background=\"background\">" << std::endl;
+    out << "    <Lights>" << std::endl;
+    for (int l = 0; l < options.lights; ++l)
+    {
+        out << "      <Light Type=\"PointLight\" Position=\"light" << l
+            << "\" Ambient=\"ambient\" Diffuse=\"light\" Specular=\"light\"/>" << std::endl;
+    }
+    out << "    </Lights>" << std::endl;
+    out << "    <IlluminationModels>" << std::endl;
+    out << "      <Model ID=\"phong\" Type=\"Phong\"><Ka>0.2</Ka><Kd>0.6</Kd><Ks>0.3</Ks></Model>" << std::endl;
+    out << "      <Model ID=\"checker\" Type=\"CheckerBoardXZ\"><Color1>checkLight</Color1><Color2>checkDark</Color2>"
+        << "<CheckSize>" << 0.1 * FLOOR_SIZE << "</CheckSize></Model>" << std::endl;
+    out << "    </IlluminationModels>" << std::endl;
+    out << "    <Models>" << std::endl;
+    out << "      <Model Type=\"File\" IlluminationModel=\"checker\">" << std::endl;
+    out << "        <Path>" << floorFile << "</Path>" << std::endl;
+    out << "      </Model>" << std::endl;
+    if (options.objects > 0)
+    {
+        out << "      <Model Type=\"File\" IlluminationModel=\"phong\">" << std::endl;
+        out << "        <Path>" << sphereFile << "</Path>" << std::endl;
+        out << "      </Model>" << std::endl;
+    }
+    out << "    </Models>" << std::endl;
+    out << "  </World>" << std::endl;
+
+    //The engine needs the Sampling element, even for one ray per pixel.
+    out << "  <Camera EyePoint=\"eye\" LookAt=\"lookAt\" Up=\"up\" FrameWidth=\"" << frame
+        << "\" FrameHeight=\"" << frame << "\" FocalDistance=\"1\">" << std::endl;
+    out << "    <Sampling Method=\"Normal\" Size=\"1\"/>" << std::endl;
+    out << "  </Camera>" << std::endl;
+    out << "</Scene>" << std::endl;
+
+    if (!out || !objects || !floor || !materials)
+    {
+        std::cerr << "Could not write " << sceneFile << ", " << sphereFile << ", " << floorFile
+                  << " or " << materialFile << std::endl;
+        return 1;
+    }
+    std::cout << sceneFile << ": " << options.objects << " spheres (" << counts[0] << " matte, " << counts[1]
+              << " mirror, " << counts[2] << " glass), " << options.lights << " lights, in " << sphereFile << std::endl;
+    return 0;
+}
@@ -0,0 +1,114 @@
+//This file contains the timeline tracer and its Chrome trace output.
+
+#include <atomic>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include "trace.h"
+
+//The number of events each process keeps, about 6MB.
+#define TRACE_CAPACITY (1 << 18)
+
+typedef struct
+{
+    double start;
+    double end;
+    int kind;
+    int peer;
+} TraceRecord;
+
+bool traceEnabled = false;
+
+static std::vector<TraceRecord> records;
+static std::atomic<unsigned long> nextRecord(0);
+static double origin = 0.0;
+
+static const char* traceNames[] = { "shade", "send", "recv", "probe", "idle", "save" };
+static const char* traceCategories[] = { "compute", "comm", "comm", "comm", "wait", "io" };
+
+void traceInit()
+{
+    records.resize(TRACE_CAPACITY);
+    nextRecord = 0;
+    traceEnabled = true;
+
+    //Every process leaves the barrier at about the same moment, so the
+    //times are kept relative to that.
+    MPI_Barrier(MPI_COMM_WORLD);
+    origin = MPI_Wtime();
+}
+
+void traceRecord(TraceKind kind, double start, double end, int peer)
+{
+    unsigned long slot = nextRecord.fetch_add(1, std::memory_order_relaxed) % TRACE_CAPACITY;
+    TraceRecord* record = &records[slot];
+    record->start = start - origin;
+    record->end = end - origin;
+    record->kind = kind;
+    record->peer = peer;
+}
+
+bool traceWrite(ConfigData* data, std::string filename)
+{
+    //Put this process's events in order, oldest first.
+    unsigned long recorded = nextRecord;
+    int count = (int)std::min(recorded, (unsigned long)TRACE_CAPACITY);
+    int dropped = (int)(recorded - count);
+    std::vector<TraceRecord> mine(count);
+    for (int i = 0; i < count; ++i) {
+        mine[i] = records[(recorded - count + i) % TRACE_CAPACITY];
+    }
+    traceEnabled = false;
+
+    int counts[2] = { count, dropped };
+    std::vector<int> allCounts(2 * data->mpi_procs);
+    MPI_Gather(counts, 2, MPI_INT, &allCounts[0], 2, MPI_INT, 0, MPI_COMM_WORLD);
+
+    std::vector<int> bytes(data->mpi_procs), offsets(data->mpi_procs);
+    size_t total = 0;
+    for (int r = 0; r < data->mpi_procs; ++r) {
+        bytes[r] = allCounts[2 * r] * sizeof(TraceRecord);
+        offsets[r] = total * sizeof(TraceRecord);
+        total += allCounts[2 * r];
+    }
+
+    std::vector<TraceRecord> all(data->mpi_rank == 0 ? std::max(total, (size_t)1) : 1);
+    MPI_Gatherv(count > 0 ? &mine[0] : NULL, count * sizeof(TraceRecord), MPI_BYTE,
+                &all[0], &bytes[0], &offsets[0], MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    if (data->mpi_rank != 0) {
+        return false;
+    }
+
+    FILE* fp = fopen(filename.c_str(), "w");
+    if (fp == NULL) {
+        return false;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"raytrace_mpi\"}}");
+    for (int r = 0; r < data->mpi_procs; ++r) {
+        fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"Rank %d%s\"}}",
+                r, r, allCounts[2 * r + 1] > 0 ? " (oldest events dropped)" : "");
+        fprintf(fp, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"sort_index\":%d}}", r, r);
+    }
+
+    //Times are in microseconds.
+    for (int r = 0; r < data->mpi_procs; ++r) {
+        for (int i = 0; i < allCounts[2 * r]; ++i) {
+            const TraceRecord& record = all[offsets[r] / sizeof(TraceRecord) + i];
+            fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                    traceNames[record.kind], traceCategories[record.kind], r,
+                    record.start * 1e6, (record.end - record.start) * 1e6);
+            if (record.peer >= 0) {
+                fprintf(fp, ",\"args\":{\"peer\":%d}", record.peer);
+            }
+            fprintf(fp, "}");
+        }
+    }
+    fprintf(fp, "\n]}\n");
+
+    bool written = !ferror(fp);
+    fclose(fp);
+    return written;
+}
@@ -0,0 +1,97 @@
+//This file contains the largest-first ordering used by -lpt.
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <mpi.h>
+#include <x86intrin.h>
+#include "unit_order.h"
+#include "costmap.h"
+#include "region.h"
+
+//Time a few pixels of the unit and scale them up to its area.
+static double probeUnit(ConfigData* data, const WorkUnit& unit, long long* samples)
+{
+    ConfigData* engine = renderRegion.active ? &renderRegion.frame : data;
+    int rowOffset = renderRegion.active ? renderRegion.y : 0;
+    int colOffset = renderRegion.active ? renderRegion.x : 0;
+
+    //Points at a quarter and three quarters of the way across, or the
+    //middle when the unit is too thin for two.
+    int rows[2] = { unit.blockHeight / 4, (3 * unit.blockHeight) / 4 };
+    int cols[2] = { unit.blockWidth / 4, (3 * unit.blockWidth) / 4 };
+    int rowCount = rows[0] == rows[1] ? 1 : 2;
+    int colCount = cols[0] == cols[1] ? 1 : 2;
+
+    float color[3];
+    unsigned long long cycles = 0;
+    for (int i = 0; i < rowCount; ++i) {
+        for (int j = 0; j < colCount; ++j) {
+            unsigned long long start = __rdtsc();
+            shadePixel(color, unit.startRow + rows[i] + rowOffset, unit.startCol + cols[j] + colOffset, engine);
+            cycles += __rdtsc() - start;
+        }
+    }
+    *samples += rowCount * colCount;
+    return (double)cycles / (rowCount * colCount) * unit.blockWidth * unit.blockHeight;
+}
+
+//Add up the cells of the grid under the unit, stretching the grid over
+//the image.
+static double gridUnit(ConfigData* data, const CostMap* map, const WorkUnit& unit)
+{
+    double top = (double)unit.startRow * map->rows / data->height;
+    double bottom = (double)(unit.startRow + unit.blockHeight) * map->rows / data->height;
+    double left = (double)unit.startCol * map->cols / data->width;
+    double right = (double)(unit.startCol + unit.blockWidth) * map->cols / data->width;
+
+    double cost = 0.0;
+    for (int r = (int)top; r < map->rows && r < bottom; ++r) {
+        double height = std::min(bottom, r + 1.0) - std::max(top, (double)r);
+        for (int c = (int)left; c < map->cols && c < right; ++c) {
+            double width = std::min(right, c + 1.0) - std::max(left, (double)c);
+            cost += map->cost[r * map->cols + c] * height * width;
+        }
+    }
+    return cost;
+}
+
+static bool largerCost(const std::pair<double, WorkUnit>& a, const std::pair<double, WorkUnit>& b)
+{
+    return a.first > b.first;
+}
+
+void orderUnitsByCost(ConfigData* data, std::string source, std::queue<WorkUnit>* queue)
+{
+    double start = MPI_Wtime();
+    CostMap map;
+    bool probe = source == "probe";
+    if (!probe && (!costMapRead(source, &map) || map.cols <= 0 || map.rows <= 0)) {
+        std::cout << "Queue Order: the cost grid " << source << " could not be read, so it stays row-major" << std::endl;
+        return;
+    }
+
+    std::vector< std::pair<double, WorkUnit> > units;
+    long long samples = 0;
+    while (!queue->empty()) {
+        const WorkUnit& unit = queue->front();
+        double cost = probe ? probeUnit(data, unit, &samples) : gridUnit(data, &map, unit);
+        units.push_back(std::make_pair(cost, unit));
+        queue->pop();
+    }
+
+    //Ties keep their row-major order.
+    std::stable_sort(units.begin(), units.end(), largerCost);
+    for (size_t i = 0; i < units.size(); ++i) {
+        queue->push(units[i].second);
+    }
+
+    std::cout << "Queue Order: largest first, from ";
+    if (probe) {
+        std::cout << "a probe of " << samples << " pixels";
+    }
+    else {
+        std::cout << source;
+    }
+    std::cout << " (" << MPI_Wtime() - start << " seconds)" << std::endl;
+}